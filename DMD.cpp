@@ -24,28 +24,65 @@
 
 --------------------------------------------------------------------------------------*/
 #include "DMD.h"
+#include "DMDFrameDecoder.h"
+#include "DMDTrace.h"
+
+//Number of pixel rows drawChar renders for a font of the given height, single byte high fonts
+//also render the blank row beneath the glyph
+static inline uint8_t glyphRows(uint8_t height)
+{
+    return (height < 8) ? height + 1 : height;
+}
+
+//Call the mode specialised version of a function for a graphics mode known only at run time,
+//so the mode is resolved once for the whole primitive rather than for every pixel
+#define DISPATCH_MODE(bGraphicsMode, function, args) \
+    switch (bGraphicsMode) { \
+    case GRAPHICS_NORMAL:  function<GRAPHICS_NORMAL> args; break; \
+    case GRAPHICS_INVERSE: function<GRAPHICS_INVERSE> args; break; \
+    case GRAPHICS_TOGGLE:  function<GRAPHICS_TOGGLE> args; break; \
+    case GRAPHICS_OR:      function<GRAPHICS_OR> args; break; \
+    case GRAPHICS_NOR:     function<GRAPHICS_NOR> args; break; \
+    }
 
 /*--------------------------------------------------------------------------------------
  Setup and instantiation of DMD library
  Note this currently uses the SPI port for the fastest performance to the DMD, be
  careful of possible conflicts with other SPI port devices
 --------------------------------------------------------------------------------------*/
-DMD::DMD(byte panelsWide, byte panelsHigh)
+DMD::DMD(DMDPanelCount panelsWide, DMDPanelCount panelsHigh)
 {
     uint16_t ui;
     DisplaysWide=panelsWide;
     DisplaysHigh=panelsHigh;
     DisplaysTotal=DisplaysWide*DisplaysHigh;
-    row1 = DisplaysTotal<<4;
-    row2 = DisplaysTotal<<5;
-    row3 = ((DisplaysTotal<<2)*3)<<2;
-    bDMDScreenRAM = (byte *) malloc(DisplaysTotal*DMD_RAM_SIZE_BYTES);
+    row1 = (DMDRamOffset)DisplaysTotal<<4;
+    row2 = (DMDRamOffset)DisplaysTotal<<5;
+    row3 = (((DMDRamOffset)DisplaysTotal<<2)*3)<<2;
+    bDMDPageRAM = (byte *) malloc(getScreenRAMSize());
+    bDMDDisplayRAM = bDMDPageRAM;
+    initCanvas(bDMDPageRAM, DMD_PIXELS_ACROSS * DisplaysWide, DMD_PIXELS_DOWN * DisplaysHigh,
+	       (DMDRamOffset)(DMD_PIXELS_ACROSS / 8) * DisplaysWide,
+	       (DMDRamOffset)(DMD_PIXELS_ACROSS / 8) * DisplaysTotal);
+    pageCount = 1;
+    drawPage = 0;
+    shownPage = 0;
+    nextPage = 0;
+
+    marqueeText = NULL;
+    marqueeProgmem = false;
+    marqueeBuffer = NULL;
+    marqueeBufferSize = 0;
+    marqueeLength = 0;
 
     // initialize the SPI port
     SPI.begin();		// probably don't need this since it inits the port pins only, which we do just below with the appropriate DMD interface setup
+#ifndef SPI_HAS_TRANSACTION
+    // no transactions, so the whole bus is set up for the DMD
     SPI.setBitOrder(MSBFIRST);	//
     SPI.setDataMode(SPI_MODE0);	// CPOL=0, CPHA=0
     SPI.setClockDivider(SPI_CLOCK_DIV4);	// system clock / 4 = 4MHz SPI CLK to shift registers. If using a short cable, can put SPI_CLOCK_DIV2 here for 2x faster updates
+#endif
 
     digitalWrite(PIN_DMD_A, LOW);	// 
     digitalWrite(PIN_DMD_B, LOW);	// 
@@ -65,6 +102,9 @@ DMD::DMD(byte panelsWide, byte panelsHigh)
 
     // init the scan line/ram pointer to the required start point
     bDMDByte = 0;
+    for (byte g = 0; g < 4; g++)
+	    litPixels[g] = 0;
+    powerLimit = 0;
 }
 
 //DMD::~DMD()
@@ -73,73 +113,518 @@ DMD::DMD(byte panelsWide, byte panelsHigh)
 //}
 
 /*--------------------------------------------------------------------------------------
- Set or clear a pixel at the x and y location (0,0 is the top left corner)
+ An off-screen canvas drawing into a buffer of the sketch's, rows are padded to whole
+ bytes and follow one another in the buffer
+--------------------------------------------------------------------------------------*/
+DMDCanvas::DMDCanvas(byte *buffer, int width, int height)
+{
+    DMDRamOffset rowBytes = (width + 7) / 8;
+    initCanvas(buffer, width, height, rowBytes * DMD_PIXELS_DOWN, rowBytes);
+}
+
+DMDCanvas::DMDCanvas()
+{
+}
+
+DMDRamOffset DMDCanvas::bufferSize(int width, int height)
+{
+    return (DMDRamOffset)((width + 7) / 8) * height;
+}
+
+void DMDCanvas::initCanvas(byte *buffer, int width, int height, DMDRamOffset bandStride,
+			   DMDRamOffset rowStride)
+{
+    bDMDCanvasRAM = buffer;
+    bDMDScreenRAM = buffer;
+    pixelsWide = width;
+    pixelsHigh = height;
+    bytesWide = (width + 7) / 8;
+    this->bandStride = bandStride;
+    this->rowStride = rowStride;
+    bufferBytes = bufferSize(width, height);
+
+    glyphCache = NULL;
+    glyphCacheSize = 0;
+    glyphCacheSlots = 0;
+    glyphCacheSlotBytes = 0;
+    glyphCacheHits = 0;
+    glyphCacheMisses = 0;
+
+    Font = NULL;
+    rowFont = false;
+
+    dirtyRows = NULL;
+    resetClip();
+}
+
+/*--------------------------------------------------------------------------------------
+ Size of the whole display in pixels
+--------------------------------------------------------------------------------------*/
+int DMDCanvas::getWidth()
+{
+    return pixelsWide;
+}
+
+int DMDCanvas::getHeight()
+{
+    return pixelsHigh;
+}
+
+/*--------------------------------------------------------------------------------------
+ Clip rectangles and viewports. Every primitive adds the origin to its coordinates and
+ draws only inside the clip rectangle, both kept in canvas pixels. The marquee, the
+ transitions and the frame decoder work on the whole display and ignore them
+--------------------------------------------------------------------------------------*/
+boolean DMDCanvas::pushClip(int x, int y, int width, int height)
+{
+    return pushClipRect(x, y, width, height, false);
+}
+
+boolean DMDCanvas::pushViewport(int x, int y, int width, int height)
+{
+    return pushClipRect(x, y, width, height, true);
+}
+
+boolean DMDCanvas::pushClipRect(int x, int y, int width, int height, boolean viewport)
+{
+    if (clipDepth >= DMD_CLIP_STACK_DEPTH) return false;
+    clipStack[clipDepth++] = clip;
+
+    x += clip.originX;
+    y += clip.originY;
+    if (viewport) {
+	    clip.originX = x;
+	    clip.originY = y;
+    }
+    // the new rectangle can only narrow the one in use
+    if (x > clip.x1) clip.x1 = x;
+    if (y > clip.y1) clip.y1 = y;
+    if (x + width - 1 < clip.x2) clip.x2 = x + width - 1;
+    if (y + height - 1 < clip.y2) clip.y2 = y + height - 1;
+    if (clip.x1 > clip.x2 || clip.y1 > clip.y2) {
+	    // nothing left, empty both ways so every primitive can rely on either test
+	    clip.x2 = clip.x1 - 1;
+	    clip.y2 = clip.y1 - 1;
+    }
+    return true;
+}
+
+void DMDCanvas::popClip()
+{
+    if (clipDepth > 0) clip = clipStack[--clipDepth];
+}
+
+void DMDCanvas::resetClip()
+{
+    clip.x1 = 0;
+    clip.y1 = 0;
+    clip.x2 = pixelsWide - 1;
+    clip.y2 = pixelsHigh - 1;
+    clip.originX = 0;
+    clip.originY = 0;
+    clipDepth = 0;
+}
+
+/*--------------------------------------------------------------------------------------
+ DMD RAM of the draw page and of the page being shown, and their size in bytes
+--------------------------------------------------------------------------------------*/
+byte* DMD::getScreenRAM()
+{
+    return bDMDCanvasRAM;
+}
+
+byte* DMD::getShownPageRAM()
+{
+    // the page number is read in one go, unlike the scan's pointer
+    return bDMDPageRAM + shownPage * getScreenRAMSize();
+}
+
+DMDRamOffset DMD::getScreenRAMSize()
+{
+    return (DMDRamOffset)DMD_RAM_SIZE_BYTES * DisplaysTotal;
+}
+
+/*--------------------------------------------------------------------------------------
+ Dirty tracking, each row keeps the range of bytes drawing has changed since the consumer
+ last cleared it. Marking is conservative, a byte written with the value it had still
+ counts as changed
+--------------------------------------------------------------------------------------*/
+boolean DMDCanvas::setDirtyTracking(boolean enable)
+{
+    free(dirtyRows);
+    dirtyRows = NULL;
+    if (!enable) return true;
+    dirtyRows = (DMDDirtyRow *) malloc(pixelsHigh * sizeof(DMDDirtyRow));
+    if (dirtyRows == NULL) return false;
+    clearDirty();
+    markDirtyRows(0, pixelsHigh - 1, 0, bytesWide - 1);
+    return true;
+}
+
+void DMDCanvas::markDirtyRows(int y1, int y2, int first, int last)
+{
+    if (dirtyRows == NULL) return;
+    for (int y = y1; y <= y2; y++)
+	    markDirtyBytes(y, first, last);
+}
+
+void DMDCanvas::markDirty(int x1, int y1, int x2, int y2)
+{
+    if (x1 > x2) {
+	    int t = x1;
+	    x1 = x2;
+	    x2 = t;
+    }
+    if (y1 > y2) {
+	    int t = y1;
+	    y1 = y2;
+	    y2 = t;
+    }
+    if (x1 < 0) x1 = 0;
+    if (y1 < 0) y1 = 0;
+    if (x2 >= pixelsWide) x2 = pixelsWide - 1;
+    if (y2 >= pixelsHigh) y2 = pixelsHigh - 1;
+    if (x1 > x2) return;
+    markDirtyRows(y1, y2, x1 >> 3, x2 >> 3);
+}
+
+boolean DMDCanvas::isDirty()
+{
+    if (dirtyRows == NULL) return false;
+    for (int y = 0; y < pixelsHigh; y++) {
+	    if (dirtyRows[y].first <= dirtyRows[y].last) return true;
+    }
+    return false;
+}
+
+boolean DMDCanvas::getDirtySpan(int bY, int *firstByte, int *lastByte)
+{
+    if (dirtyRows == NULL || bY < 0 || bY >= pixelsHigh) return false;
+    if (dirtyRows[bY].first > dirtyRows[bY].last) return false;
+    *firstByte = dirtyRows[bY].first;
+    *lastByte = dirtyRows[bY].last;
+    return true;
+}
+
+void DMDCanvas::clearDirty()
+{
+    if (dirtyRows == NULL) return;
+    for (int y = 0; y < pixelsHigh; y++) {
+	    dirtyRows[y].first = 0xFFFF;
+	    dirtyRows[y].last = 0;
+    }
+}
+
+//Write a patch frame run leaving count bytes unchanged, count must be at least 2
+static size_t writeSkip(Print &out, DMDRamOffset count)
+{
+    size_t written = 0;
+    while (count >= 2) {
+	    byte run = (count == 130) ? 128 : ((count > 129) ? 129 : count);	// never leave a single byte
+	    written += out.write(0x80 + run - 2);
+	    count -= run;
+    }
+    return written;
+}
+
+//Write patch frame runs of literal bytes
+static size_t writeLiteral(Print &out, const byte *bytes, DMDRamOffset count)
+{
+    size_t written = 0;
+    while (count > 0) {
+	    byte run = (count > 128) ? 128 : count;
+	    written += out.write(run - 1);
+	    written += out.write(bytes, run);
+	    bytes += run;
+	    count -= run;
+    }
+    return written;
+}
+
+/*--------------------------------------------------------------------------------------
+ Write the changed bytes as a patch frame: literal runs for each dirty span and skip runs
+ over the bytes between them, in DMD RAM order. Rows of the DMD are interleaved in RAM,
+ so the rows are walked by their RAM offset rather than top to bottom
+--------------------------------------------------------------------------------------*/
+size_t DMDCanvas::writeDirtyFrame(Print &out)
+{
+    DMD_TRACE_SCOPE(DMD_TRACE_DIRTY_FRAME);
+#ifdef DMD_WIDE_ADDRESSING
+    if (bufferBytes > 0xFFFF) return 0;	// past what a frame's length can say
+#endif
+    size_t written = out.write(DMD_FRAME_MAGIC);
+    written += out.write(DMD_FRAME_PATCH);
+    written += out.write(bufferBytes & 0xFF);
+    written += out.write((bufferBytes >> 8) & 0xFF);
+
+    int bands = (pixelsHigh + DMD_PIXELS_DOWN - 1) / DMD_PIXELS_DOWN;
+    boolean interleaved = bandStride < rowStride * DMD_PIXELS_DOWN;
+    DMDRamOffset position = 0;
+    for (int i = 0; i < pixelsHigh; i++) {
+	    int y = interleaved ? (i % bands) * DMD_PIXELS_DOWN + i / bands : i;
+	    int first, last;
+	    if (!getDirtySpan(y, &first, &last)) continue;
+	    DMDRamOffset start = rowOffset(y) + first;
+	    DMDRamOffset end = rowOffset(y) + last + 1;
+	    if (start == position + 1) start--;	// a skip covers at least 2 bytes
+	    written += writeSkip(out, start - position);
+	    written += writeLiteral(out, bDMDScreenRAM + start, end - start);
+	    position = end;
+    }
+    if (position + 1 == bufferBytes)
+	    written += writeLiteral(out, bDMDScreenRAM + position, 1);
+    else
+	    written += writeSkip(out, bufferBytes - position);
+    return written;
+}
+
+/*--------------------------------------------------------------------------------------
+ Direct all drawing to an off-screen buffer laid out like this canvas, or back to the
+ canvas with NULL, which for the DMD is its draw page. The display keeps scanning DMD RAM.
+ Exports read the draw buffer, so a new one is all changed as far as a mirror knows
+--------------------------------------------------------------------------------------*/
+void DMDCanvas::setDrawBuffer(byte* buffer)
+{
+    byte *previous = bDMDScreenRAM;
+    bDMDScreenRAM = buffer ? buffer : bDMDCanvasRAM;
+    if (bDMDScreenRAM != previous) markDirtyRows(0, pixelsHigh - 1, 0, bytesWide - 1);
+}
+
+byte* DMDCanvas::getDrawBuffer()
+{
+    return bDMDScreenRAM;
+}
+
+/*--------------------------------------------------------------------------------------
+ Grow or shrink DMD RAM to hold count pages. The block can move, so the scan is held
+ off until its pointer is updated. Pointers the sketch took from getScreenRAM() before
+ are stale afterwards
+--------------------------------------------------------------------------------------*/
+boolean DMD::setPages(byte count)
+{
+    if (count == 0) count = 1;
+    DMDRamOffset size = getScreenRAMSize();
+    boolean toPage = (bDMDScreenRAM == bDMDCanvasRAM);
+    byte oldDrawPage = drawPage;
+
+    noInterrupts();
+    byte *ram = (byte *) realloc(bDMDPageRAM, (size_t)count * size);
+    if (ram != NULL) {
+	    bDMDPageRAM = ram;
+	    if (shownPage >= count) shownPage = 0;
+	    if (nextPage >= count) nextPage = shownPage;
+	    if (drawPage >= count) drawPage = 0;
+	    bDMDDisplayRAM = ram + shownPage * size;
+	    bDMDCanvasRAM = ram + drawPage * size;
+	    if (toPage) bDMDScreenRAM = bDMDCanvasRAM;
+    }
+    interrupts();
+    if (ram == NULL) return false;
+
+    if (count > pageCount)
+	    memset(ram + pageCount * size, 0xFF, (size_t)(count - pageCount) * size);
+    pageCount = count;
+    // dropping the draw page falls back to page 0, which exports then read
+    if (toPage && drawPage != oldDrawPage) markDirtyRows(0, pixelsHigh - 1, 0, bytesWide - 1);
+    return true;
+}
+
+byte DMD::getPageCount()
+{
+    return pageCount;
+}
+
+void DMD::drawToPage(byte page)
+{
+    if (page >= pageCount) return;
+    byte *previous = bDMDScreenRAM;
+    drawPage = page;
+    bDMDCanvasRAM = bDMDPageRAM + page * getScreenRAMSize();
+    bDMDScreenRAM = bDMDCanvasRAM;
+    // exports now read another page
+    if (bDMDScreenRAM != previous) markDirtyRows(0, pixelsHigh - 1, 0, bytesWide - 1);
+}
+
+byte DMD::getDrawPage()
+{
+    return drawPage;
+}
+
+void DMD::showPage(byte page)
+{
+    if (page < pageCount) nextPage = page;
+}
+
+byte DMD::getShownPage()
+{
+    return shownPage;
+}
+
+/*--------------------------------------------------------------------------------------
+ Set or clear a pixel at the x and y location (0,0 is the top left corner, or of the
+ viewport when one is pushed)
 --------------------------------------------------------------------------------------*/
 void
- DMD::writePixel(unsigned int bX, unsigned int bY, byte bGraphicsMode, byte bPixel)
+ DMDCanvas::writePixel(unsigned int bX, unsigned int bY, byte bGraphicsMode, byte bPixel)
 {
-    unsigned int uiDMDRAMPointer;
+#ifdef DMD_TRACE_PIXELS
+    DMD_TRACE_SCOPE(DMD_TRACE_WRITE_PIXEL);
+#endif
+    DISPATCH_MODE(bGraphicsMode, writePixel, (bX, bY, bPixel));
+}
 
-    if (bX >= (DMD_PIXELS_ACROSS*DisplaysWide) || bY >= (DMD_PIXELS_DOWN * DisplaysHigh)) {
+template <byte MODE>
+void DMDCanvas::writePixel(unsigned int bX, unsigned int bY, byte bPixel)
+{
+    int x = (int)bX + clip.originX;
+    int y = (int)bY + clip.originY;
+    if (x < clip.x1 || x > clip.x2 || y < clip.y1 || y > clip.y2) {
 	    return;
     }
-    byte panel=(bX/DMD_PIXELS_ACROSS) + (DisplaysWide*(bY/DMD_PIXELS_DOWN));
-    bX=(bX % DMD_PIXELS_ACROSS) + (panel<<5);
-    bY=bY % DMD_PIXELS_DOWN;
-    //set pointer to DMD RAM byte to be modified
-    uiDMDRAMPointer = bX/8 + bY*(DisplaysTotal<<2);
+    writePixelUnchecked<MODE>(x, y, bPixel);
+}
 
-    byte lookup = bPixelLookupTable[bX & 0x07];
+/*--------------------------------------------------------------------------------------
+ Read back a pixel at the x and y location, relative to the viewport like writePixel
+--------------------------------------------------------------------------------------*/
+boolean DMDCanvas::readPixel(int bX, int bY)
+{
+    bX += clip.originX;
+    bY += clip.originY;
+    if (bX < 0 || bY < 0 || bX >= pixelsWide || bY >= pixelsHigh) return false;
+    return !(bDMDScreenRAM[rowOffset(bY) + (bX >> 3)] & bPixelLookupTable[bX & 0x07]);
+}
 
-    switch (bGraphicsMode) {
-    case GRAPHICS_NORMAL:
-	    if (bPixel == true)
-		bDMDScreenRAM[uiDMDRAMPointer] &= ~lookup;	// zero bit is pixel on
-	    else
-		bDMDScreenRAM[uiDMDRAMPointer] |= lookup;	// one bit is pixel off
-	    break;
-    case GRAPHICS_INVERSE:
-	    if (bPixel == false)
-		    bDMDScreenRAM[uiDMDRAMPointer] &= ~lookup;	// zero bit is pixel on
-	    else
-		    bDMDScreenRAM[uiDMDRAMPointer] |= lookup;	// one bit is pixel off
-	    break;
-    case GRAPHICS_TOGGLE:
-	    if (bPixel == true) {
-		if ((bDMDScreenRAM[uiDMDRAMPointer] & lookup) == 0)
-		    bDMDScreenRAM[uiDMDRAMPointer] |= lookup;	// one bit is pixel off
-		else
-		    bDMDScreenRAM[uiDMDRAMPointer] &= ~lookup;	// one bit is pixel off
+/*--------------------------------------------------------------------------------------
+ Snapshots as PBM images in logical pixel order, streamed straight from RAM a row at a
+ time with no copy of the image. A row of DMD RAM is already a row of a P4 image with
+ the opposite polarity, padding bits past the last pixel are ignored by PBM readers
+--------------------------------------------------------------------------------------*/
+size_t DMDCanvas::writePBM(Print &out, boolean plain)
+{
+    return writePBMFrom(out, bDMDScreenRAM, plain);
+}
+
+size_t DMD::writePBM(Print &out, boolean plain)
+{
+    return writePBMFrom(out, getShownPageRAM(), plain);
+}
+
+size_t DMDCanvas::writePBMFrom(Print &out, const byte *ram, boolean plain)
+{
+    DMD_TRACE_SCOPE(DMD_TRACE_WRITE_PBM);
+    size_t written = out.print(plain ? "P1\n" : "P4\n");
+    written += out.print(pixelsWide);
+    written += out.print(' ');
+    written += out.print(pixelsHigh);
+    written += out.print('\n');	// a single whitespace before the P4 raster, so not println()
+    for (int y = 0; y < pixelsHigh; y++) {
+	    const byte *row = ram + rowOffset(y);
+	    if (!plain) {
+	        for (DMDRamOffset b = 0; b < bytesWide; b++)
+		        written += out.write((byte)~row[b]);
+	        continue;
 	    }
-	    break;
-    case GRAPHICS_OR:
-	    //only set pixels on
-	    if (bPixel == true)
-		    bDMDScreenRAM[uiDMDRAMPointer] &= ~lookup;	// zero bit is pixel on
-	    break;
-    case GRAPHICS_NOR:
-	    //only clear on pixels
-	    if ((bPixel == true) &&
-		    ((bDMDScreenRAM[uiDMDRAMPointer] & lookup) == 0))
-		    bDMDScreenRAM[uiDMDRAMPointer] |= lookup;	// one bit is pixel off
-	    break;
+	    for (int x = 0; x < pixelsWide; x++)
+	        written += out.write((row[x >> 3] & bPixelLookupTable[x & 0x07]) ? '0' : '1');
+	    written += out.print('\n');
+    }
+    return written;
+}
+
+//Read a character of a string held in RAM or PROGMEM
+static inline unsigned char textChar(const char *bChars, DMDTextLength i, boolean progmem)
+{
+    return progmem ? pgm_read_byte(bChars + i) : bChars[i];
+}
+
+//Read the code point of the UTF-8 sequence at bChars[*i] in a string held in RAM or PROGMEM,
+//advancing *i past it
+static uint16_t textCodePoint(const char *bChars, DMDTextLength length, DMDTextLength *i, boolean progmem)
+{
+    byte bytes[4];
+    DMDTextLength count = length - *i;
+    byte used;
+
+    bytes[0] = textChar(bChars, *i, progmem);
+    if (bytes[0] < 0x80) {
+	    (*i)++;
+	    return bytes[0];
     }
+    if (count > 4) count = 4;
+    for (byte k = 1; k < count; k++)
+	    bytes[k] = textChar(bChars, *i + k, progmem);
+    uint16_t code = DMDCanvas::decodeUTF8(bytes, count, &used);
+    *i += used;
+    return code;
+}
+
+/*--------------------------------------------------------------------------------------
+ Decode the UTF-8 sequence at the start of count bytes, setting used to its length.
+ Bytes that do not start a valid sequence are taken as a single Latin-1 character so
+ strings written with Latin-1 escapes still draw, and code points past the 16 bit range
+ fonts can hold decode to U+FFFD
+--------------------------------------------------------------------------------------*/
+uint16_t DMDCanvas::decodeUTF8(const byte *bytes, byte count, byte *used)
+{
+    static const unsigned long smallest[4] = { 0, 0x80, 0x800, 0x10000 };
+    byte lead = bytes[0];
+    byte extra;
+    unsigned long code;
 
+    *used = 1;
+    if (lead < 0x80) return lead;
+    if ((lead & 0xE0) == 0xC0) {
+	    extra = 1;
+	    code = lead & 0x1F;
+    } else if ((lead & 0xF0) == 0xE0) {
+	    extra = 2;
+	    code = lead & 0x0F;
+    } else if ((lead & 0xF8) == 0xF0) {
+	    extra = 3;
+	    code = lead & 0x07;
+    } else {
+	    return lead;	// stray continuation byte
+    }
+    if (extra >= count) return lead;
+    for (byte k = 1; k <= extra; k++) {
+	    if ((bytes[k] & 0xC0) != 0x80) return lead;
+	    code = (code << 6) | (bytes[k] & 0x3F);
+    }
+    // overlong encodings are not UTF-8
+    if (code < smallest[extra]) return lead;
+    *used = extra + 1;
+    if (code > 0xFFFF || (code >= 0xD800 && code <= 0xDFFF)) return DMD_REPLACEMENT_CHAR;
+    return code;
 }
 
-void DMD::drawString(int bX, int bY, const char *bChars, byte length,
+void DMDCanvas::drawString(int bX, int bY, const char *bChars, DMDTextLength length,
 		     byte bGraphicsMode)
 {
-    if (bX >= (DMD_PIXELS_ACROSS*DisplaysWide) || bY >= DMD_PIXELS_DOWN * DisplaysHigh)
+    DMD_TRACE_SCOPE(DMD_TRACE_DRAW_STRING);
+    drawStringFrom(bX, bY, bChars, length, bGraphicsMode, false);
+}
+
+void DMDCanvas::drawString_P(int bX, int bY, const char *bChars, DMDTextLength length,
+		       byte bGraphicsMode)
+{
+    DMD_TRACE_SCOPE(DMD_TRACE_DRAW_STRING);
+    drawStringFrom(bX, bY, bChars, length, bGraphicsMode, true);
+}
+
+void DMDCanvas::drawStringFrom(int bX, int bY, const char *bChars, DMDTextLength length,
+			 byte bGraphicsMode, boolean progmem)
+{
+    if (bX + clip.originX > clip.x2 || bY + clip.originY > clip.y2)
 	return;
     uint8_t height = pgm_read_byte(this->Font + FONT_HEIGHT);
-    if (bY+height<0) return;
+    if (bY + clip.originY + height < clip.y1) return;
 
     int strWidth = 0;
 	this->drawLine(bX -1 , bY, bX -1 , bY + height, GRAPHICS_INVERSE);
 
-    for (int i = 0; i < length; i++) {
-        int charWide = this->drawChar(bX+strWidth, bY, bChars[i], bGraphicsMode);
+    for (DMDTextLength i = 0; i < length; ) {
+        int charWide = this->drawGlyph(bX+strWidth, bY, textCodePoint(bChars, length, &i, progmem), bGraphicsMode);
 	    if (charWide > 0) {
 	        strWidth += charWide ;
 	        this->drawLine(bX + strWidth , bY, bX + strWidth , bY + height, GRAPHICS_INVERSE);
@@ -147,36 +632,64 @@ void DMD::drawString(int bX, int bY, const char *bChars, byte length,
         } else if (charWide < 0) {
             return;
         }
-        if ((bX + strWidth) >= DMD_PIXELS_ACROSS * DisplaysWide || bY >= DMD_PIXELS_DOWN * DisplaysHigh) return;
+        if (bX + strWidth + clip.originX > clip.x2) return;
+    }
+}
+
+void DMD::drawMarquee(const char *bChars, DMDTextLength length, int left, int top)
+{
+    DMD_TRACE_SCOPE(DMD_TRACE_DRAW_MARQUEE);
+    if (length + 1u > marqueeBufferSize) {
+	    char *buffer = (char *) realloc(marqueeBuffer, length + 1);
+	    if (buffer == NULL) return;
+	    marqueeBuffer = buffer;
+	    marqueeBufferSize = length + 1;
     }
+    memcpy(marqueeBuffer, bChars, length);
+    marqueeBuffer[length] = '\0';
+    marqueeText = marqueeBuffer;
+    marqueeProgmem = false;
+    startMarquee(length, left, top);
 }
 
-void DMD::drawMarquee(const char *bChars, byte length, int left, int top)
+void DMD::drawMarquee_P(const char *bChars, DMDTextLength length, int left, int top)
 {
+    DMD_TRACE_SCOPE(DMD_TRACE_DRAW_MARQUEE);
+    marqueeText = bChars;
+    marqueeProgmem = true;
+    startMarquee(length, left, top);
+}
+
+void DMD::startMarquee(DMDTextLength length, int left, int top)
+{
+    marqueeLength = length;
     marqueeWidth = 0;
-    for (int i = 0; i < length; i++) {
-	    marqueeText[i] = bChars[i];
-	    marqueeWidth += charWidth(bChars[i]) + 1;
+    for (DMDTextLength i = 0; i < length; ) {
+	    marqueeWidth += glyphWidth(marqueeCodePoint(&i)) + 1;
     }
     marqueeHeight=pgm_read_byte(this->Font + FONT_HEIGHT);
-    marqueeText[length] = '\0';
     marqueeOffsetY = top;
     marqueeOffsetX = left;
-    marqueeLength = length;
-    drawString(marqueeOffsetX, marqueeOffsetY, marqueeText, marqueeLength,
-	   GRAPHICS_NORMAL);
+    drawStringFrom(marqueeOffsetX, marqueeOffsetY, marqueeText, marqueeLength,
+	   GRAPHICS_NORMAL, marqueeProgmem);
+}
+
+uint16_t DMD::marqueeCodePoint(DMDTextLength *i)
+{
+    return textCodePoint(marqueeText, marqueeLength, i, marqueeProgmem);
 }
 
 boolean DMD::stepMarquee(int amountX, int amountY)
 {
+    DMD_TRACE_SCOPE(DMD_TRACE_STEP_MARQUEE);
     boolean ret=false;
     marqueeOffsetX += amountX;
     marqueeOffsetY += amountY;
     if (marqueeOffsetX < -marqueeWidth) {
-	    marqueeOffsetX = DMD_PIXELS_ACROSS * DisplaysWide;
+	    marqueeOffsetX = pixelsWide;
 	    clearScreen(true);
         ret=true;
-    } else if (marqueeOffsetX > DMD_PIXELS_ACROSS * DisplaysWide) {
+    } else if (marqueeOffsetX > pixelsWide) {
 	    marqueeOffsetX = -marqueeWidth;
 	    clearScreen(true);
         ret=true;
@@ -184,20 +697,22 @@ boolean DMD::stepMarquee(int amountX, int amountY)
     
         
     if (marqueeOffsetY < -marqueeHeight) {
-	    marqueeOffsetY = DMD_PIXELS_DOWN * DisplaysHigh;
+	    marqueeOffsetY = pixelsHigh;
 	    clearScreen(true);
         ret=true;
-    } else if (marqueeOffsetY > DMD_PIXELS_DOWN * DisplaysHigh) {
+    } else if (marqueeOffsetY > pixelsHigh) {
 	    marqueeOffsetY = -marqueeHeight;
 	    clearScreen(true);
         ret=true;
     }
 
     // Special case horizontal scrolling to improve speed
+    if (amountY==0 && (amountX==-1 || amountX==1))
+        markDirtyRows(0, pixelsHigh - 1, 0, bytesWide - 1);
     if (amountY==0 && amountX==-1) {
         // Shift entire screen one bit
-        for (int i=0; i<DMD_RAM_SIZE_BYTES*DisplaysTotal;i++) {
-            if ((i%(DisplaysWide*4)) == (DisplaysWide*4) -1) {
+        for (DMDRamOffset i=0; i<getScreenRAMSize();i++) {
+            if ((i%((DMDRamOffset)DisplaysWide*4)) == ((DMDRamOffset)DisplaysWide*4) -1) {
                 bDMDScreenRAM[i]=(bDMDScreenRAM[i]<<1)+1;
             } else {
                 bDMDScreenRAM[i]=(bDMDScreenRAM[i]<<1) + ((bDMDScreenRAM[i+1] & 0x80) >>7);
@@ -206,18 +721,19 @@ boolean DMD::stepMarquee(int amountX, int amountY)
 
         // Redraw last char on screen
         int strWidth=marqueeOffsetX;
-        for (byte i=0; i < marqueeLength; i++) {
-            int wide = charWidth(marqueeText[i]);
-            if (strWidth+wide >= DisplaysWide*DMD_PIXELS_ACROSS) {
-                drawChar(strWidth, marqueeOffsetY,marqueeText[i],GRAPHICS_NORMAL);
+        for (DMDTextLength i=0; i < marqueeLength; ) {
+            uint16_t code = marqueeCodePoint(&i);
+            int wide = glyphWidth(code);
+            if (strWidth+wide >= pixelsWide) {
+                drawGlyph(strWidth, marqueeOffsetY,code,GRAPHICS_NORMAL);
                 return ret;
             }
             strWidth += wide+1;
         }
     } else if (amountY==0 && amountX==1) {
         // Shift entire screen one bit
-        for (int i=(DMD_RAM_SIZE_BYTES*DisplaysTotal)-1; i>=0;i--) {
-            if ((i%(DisplaysWide*4)) == 0) {
+        for (DMDRamOffset i=getScreenRAMSize(); i-- > 0;) {
+            if ((i%((DMDRamOffset)DisplaysWide*4)) == 0) {
                 bDMDScreenRAM[i]=(bDMDScreenRAM[i]>>1)+128;
             } else {
                 bDMDScreenRAM[i]=(bDMDScreenRAM[i]>>1) + ((bDMDScreenRAM[i-1] & 1) <<7);
@@ -226,17 +742,18 @@ boolean DMD::stepMarquee(int amountX, int amountY)
 
         // Redraw last char on screen
         int strWidth=marqueeOffsetX;
-        for (byte i=0; i < marqueeLength; i++) {
-            int wide = charWidth(marqueeText[i]);
+        for (DMDTextLength i=0; i < marqueeLength; ) {
+            uint16_t code = marqueeCodePoint(&i);
+            int wide = glyphWidth(code);
             if (strWidth+wide >= 0) {
-                drawChar(strWidth, marqueeOffsetY,marqueeText[i],GRAPHICS_NORMAL);
+                drawGlyph(strWidth, marqueeOffsetY,code,GRAPHICS_NORMAL);
                 return ret;
             }
             strWidth += wide+1;
         }
     } else {
-        drawString(marqueeOffsetX, marqueeOffsetY, marqueeText, marqueeLength,
-	       GRAPHICS_NORMAL);
+        drawStringFrom(marqueeOffsetX, marqueeOffsetY, marqueeText, marqueeLength,
+	       GRAPHICS_NORMAL, marqueeProgmem);
     }
 
     return ret;
@@ -244,21 +761,143 @@ boolean DMD::stepMarquee(int amountX, int amountY)
 
 
 /*--------------------------------------------------------------------------------------
- Clear the screen in DMD RAM
+ Clear the screen in DMD RAM, or only the clip rectangle when one is pushed
 --------------------------------------------------------------------------------------*/
-void DMD::clearScreen(byte bNormal)
+void DMDCanvas::clearScreen(byte bNormal)
 {
-    if (bNormal) // clear all pixels
-        memset(bDMDScreenRAM,0xFF,DMD_RAM_SIZE_BYTES*DisplaysTotal);
-    else // set all pixels
-        memset(bDMDScreenRAM,0x00,DMD_RAM_SIZE_BYTES*DisplaysTotal);
+    DMD_TRACE_SCOPE(DMD_TRACE_CLEAR_SCREEN);
+    if (clipDepth > 0) {
+        drawFilledBox(clip.x1 - clip.originX, clip.y1 - clip.originY,
+		      clip.x2 - clip.originX, clip.y2 - clip.originY,
+		      bNormal ? GRAPHICS_INVERSE : GRAPHICS_NORMAL);
+    } else {
+        if (bNormal) // clear all pixels
+            memset(bDMDScreenRAM,0xFF,bufferBytes);
+        else // set all pixels
+            memset(bDMDScreenRAM,0x00,bufferBytes);
+        markDirtyRows(0, pixelsHigh - 1, 0, bytesWide - 1);
+    }
+}
+
+/*--------------------------------------------------------------------------------------
+ Shift rows y1 to y2 one pixel left across the clip rectangle, clearing its rightmost
+ column. Pixels either side of the rectangle keep their place
+--------------------------------------------------------------------------------------*/
+void DMDCanvas::shiftRowsLeft(int y1, int y2)
+{
+    DMD_TRACE_SCOPE(DMD_TRACE_SHIFT_ROWS);
+    y1 += clip.originY;
+    y2 += clip.originY;
+    if (y1 < clip.y1) y1 = clip.y1;
+    if (y2 > clip.y2) y2 = clip.y2;
+    if (clip.x1 > clip.x2) return;
+
+    int first = clip.x1 >> 3;
+    int last = clip.x2 >> 3;
+    byte firstMask = clipMask(first);
+    byte lastMask = clipMask(last);
+    for (int y = y1; y <= y2; y++) {
+        byte *ram = bDMDScreenRAM + rowOffset(y);
+        byte head = ram[first];
+        byte tail = ram[last];
+        for (int i = first; i < last; i++) {
+            ram[i] = (ram[i] << 1) + ((ram[i + 1] & 0x80) >> 7);
+        }
+        // clears the rightmost pixel of the rectangle
+        ram[last] = (((tail << 1) | bPixelLookupTable[clip.x2 & 0x07]) & lastMask) | (tail & ~lastMask);
+        ram[first] = (ram[first] & firstMask) | (head & ~firstMask);
+    }
+    markDirtyRows(y1, y2, first, last);
 }
 
 /*--------------------------------------------------------------------------------------
  Draw or clear a line from x1,y1 to x2,y2
 --------------------------------------------------------------------------------------*/
-void DMD::drawLine(int x1, int y1, int x2, int y2, byte bGraphicsMode)
+void DMDCanvas::drawLine(int x1, int y1, int x2, int y2, byte bGraphicsMode)
+{
+    DMD_TRACE_SCOPE(DMD_TRACE_DRAW_LINE);
+    DISPATCH_MODE(bGraphicsMode, drawLine, (x1, y1, x2, y2));
+}
+
+//Cohen-Sutherland region code of a point against the display, a bit for each edge it lies beyond
+#define OUT_LEFT   1
+#define OUT_RIGHT  2
+#define OUT_TOP    4
+#define OUT_BOTTOM 8
+static inline byte outCode(int x, int y, int right, int bottom)
+{
+    byte code = 0;
+    if (x < 0) code |= OUT_LEFT;
+    else if (x > right) code |= OUT_RIGHT;
+    if (y < 0) code |= OUT_TOP;
+    else if (y > bottom) code |= OUT_BOTTOM;
+    return code;
+}
+
+static inline long floorDiv(long a, long b)
+{
+    return (a >= 0) ? a / b : -((-a + b - 1) / b);
+}
+
+static inline long ceilDiv(long a, long b)
+{
+    return (a >= 0) ? (a + b - 1) / b : -((-a) / b);
+}
+
+/*--------------------------------------------------------------------------------------
+ Narrow the Bresenham steps *first to *last of a line to those whose pixels are on the
+ display. The major axis starts at a and moves stepa each step within 0..aMax, the minor
+ axis starts at b and moves stepb within 0..bMax when the error term allows. major and
+ minor are the doubled deltas and fraction the starting error term, so after n steps the
+ minor axis has moved floor((fraction + (n-1)*minor) / major) + 1 times. Solving that for
+ n keeps exactly the pixels the unclipped line would draw.
+--------------------------------------------------------------------------------------*/
+static void clipSteps(int a, int stepa, int aMax, int b, int stepb, int bMax,
+		      long major, long minor, long fraction, long *first, long *last)
 {
+    long lo = (stepa > 0) ? -(long)a : (long)a - aMax;
+    long hi = (stepa > 0) ? (long)aMax - a : (long)a;
+    if (lo > *first) *first = lo;
+    if (hi < *last) *last = hi;
+
+    long kMin = (stepb > 0) ? -(long)b : (long)b - bMax;
+    long kMax = (stepb > 0) ? (long)bMax - b : (long)b;
+    if (kMax < 0) {
+	    *last = -1;
+	    return;
+    }
+    if (kMin > 0) {
+	    lo = 1 + ceilDiv((kMin - 1) * major - fraction, minor);
+	    if (lo < 1) lo = 1;
+	    if (lo > *first) *first = lo;
+    }
+    hi = ceilDiv(kMax * major - fraction, minor);
+    if (hi < *last) *last = hi;
+}
+
+template <byte MODE>
+void DMDCanvas::drawLine(int x1, int y1, int x2, int y2)
+{
+    if (y1 == y2) {
+	    writeSpan<MODE>(x1, x2, y1);
+	    return;
+    }
+    if (x1 == x2) {
+	    writeColumn<MODE>(x1, y1, y2);
+	    return;
+    }
+
+    // work relative to the clip rectangle, which then clips like the whole display
+    x1 += clip.originX - clip.x1;
+    y1 += clip.originY - clip.y1;
+    x2 += clip.originX - clip.x1;
+    y2 += clip.originY - clip.y1;
+    int right = clip.x2 - clip.x1;
+    int bottom = clip.y2 - clip.y1;
+    byte code1 = outCode(x1, y1, right, bottom);
+    byte code2 = outCode(x2, y2, right, bottom);
+    if (code1 & code2) return;	// both ends beyond the same edge
+
     int dy = y2 - y1;
     int dx = x2 - x1;
     int stepx, stepy;
@@ -275,31 +914,51 @@ void DMD::drawLine(int x1, int y1, int x2, int y2, byte bGraphicsMode)
     } else {
 	    stepx = 1;
     }
+    long first = 0;
+    long last = (dx > dy) ? dx : dy;
     dy <<= 1;			// dy is now 2*dy
     dx <<= 1;			// dx is now 2*dx
 
-    writePixel(x1, y1, bGraphicsMode, true);
     if (dx > dy) {
 	    int fraction = dy - (dx >> 1);	// same as 2*dy - dx
-	    while (x1 != x2) {
+	    if (code1 | code2) {
+	        // skip straight to the first step on the display
+	        clipSteps(x1, stepx, right, y1, stepy, bottom, dx, dy, fraction, &first, &last);
+	        if (first > last) return;
+	        long k = first ? floorDiv(fraction + (first - 1) * dy, dx) + 1 : 0;
+	        x1 += stepx * first;
+	        y1 += stepy * k;
+	        fraction += first * dy - k * dx;
+	    }
+	    writePixelUnchecked<MODE>(x1 + clip.x1, y1 + clip.y1, true);
+	    for (; first < last; first++) {
 	        if (fraction >= 0) {
 		        y1 += stepy;
 		        fraction -= dx;	// same as fraction -= 2*dx
 	        }
 	        x1 += stepx;
 	        fraction += dy;	// same as fraction -= 2*dy
-	        writePixel(x1, y1, bGraphicsMode, true);
+	        writePixelUnchecked<MODE>(x1 + clip.x1, y1 + clip.y1, true);
 	    }
     } else {
 	    int fraction = dx - (dy >> 1);
-	    while (y1 != y2) {
+	    if (code1 | code2) {
+	        clipSteps(y1, stepy, bottom, x1, stepx, right, dy, dx, fraction, &first, &last);
+	        if (first > last) return;
+	        long k = first ? floorDiv(fraction + (first - 1) * dx, dy) + 1 : 0;
+	        y1 += stepy * first;
+	        x1 += stepx * k;
+	        fraction += first * dx - k * dy;
+	    }
+	    writePixelUnchecked<MODE>(x1 + clip.x1, y1 + clip.y1, true);
+	    for (; first < last; first++) {
 	        if (fraction >= 0) {
 		        x1 += stepx;
 		        fraction -= dy;
 	        }
 	        y1 += stepy;
 	        fraction += dx;
-	        writePixel(x1, y1, bGraphicsMode, true);
+	        writePixelUnchecked<MODE>(x1 + clip.x1, y1 + clip.y1, true);
 	    }
     }
 }
@@ -307,130 +966,711 @@ void DMD::drawLine(int x1, int y1, int x2, int y2, byte bGraphicsMode)
 /*--------------------------------------------------------------------------------------
  Draw or clear a circle of radius r at x,y centre
 --------------------------------------------------------------------------------------*/
-void DMD::drawCircle(int xCenter, int yCenter, int radius,
+void DMDCanvas::drawCircle(int xCenter, int yCenter, int radius,
 		     byte bGraphicsMode)
 {
-    int x = 0;
-    int y = radius;
-    int p = (5 - radius * 4) / 4;
-
-    drawCircleSub(xCenter, yCenter, x, y, bGraphicsMode);
-    while (x < y) {
-	    x++;
-	    if (p < 0) {
-	        p += 2 * x + 1;
-	    } else {
-	        y--;
-	        p += 2 * (x - y) + 1;
-	    }
-	    drawCircleSub(xCenter, yCenter, x, y, bGraphicsMode);
-    }
+    DMD_TRACE_SCOPE(DMD_TRACE_DRAW_ROUND);
+    if (radius < 0) return;
+    drawRoundShape(xCenter, yCenter, xCenter, yCenter, radius, radius, false, bGraphicsMode);
 }
 
-void DMD::drawCircleSub(int cx, int cy, int x, int y, byte bGraphicsMode)
+/*--------------------------------------------------------------------------------------
+ Draw or clear a filled circle of radius r at x,y centre
+--------------------------------------------------------------------------------------*/
+void DMDCanvas::drawFilledCircle(int xCenter, int yCenter, int radius,
+			   byte bGraphicsMode)
 {
-
-    if (x == 0) {
-	    writePixel(cx, cy + y, bGraphicsMode, true);
-	    writePixel(cx, cy - y, bGraphicsMode, true);
-	    writePixel(cx + y, cy, bGraphicsMode, true);
-	    writePixel(cx - y, cy, bGraphicsMode, true);
-    } else if (x == y) {
-	    writePixel(cx + x, cy + y, bGraphicsMode, true);
-	    writePixel(cx - x, cy + y, bGraphicsMode, true);
-	    writePixel(cx + x, cy - y, bGraphicsMode, true);
-	    writePixel(cx - x, cy - y, bGraphicsMode, true);
-    } else if (x < y) {
-	    writePixel(cx + x, cy + y, bGraphicsMode, true);
-	    writePixel(cx - x, cy + y, bGraphicsMode, true);
-	    writePixel(cx + x, cy - y, bGraphicsMode, true);
-	    writePixel(cx - x, cy - y, bGraphicsMode, true);
-	    writePixel(cx + y, cy + x, bGraphicsMode, true);
-	    writePixel(cx - y, cy + x, bGraphicsMode, true);
-	    writePixel(cx + y, cy - x, bGraphicsMode, true);
-	    writePixel(cx - y, cy - x, bGraphicsMode, true);
-    }
+    DMD_TRACE_SCOPE(DMD_TRACE_DRAW_ROUND);
+    if (radius < 0) return;
+    drawRoundShape(xCenter, yCenter, xCenter, yCenter, radius, radius, true, bGraphicsMode);
 }
 
 /*--------------------------------------------------------------------------------------
- Draw or clear a box(rectangle) with a single pixel border
+ Draw or clear an ellipse with x and y radii at x,y centre
 --------------------------------------------------------------------------------------*/
-void DMD::drawBox(int x1, int y1, int x2, int y2, byte bGraphicsMode)
+void DMDCanvas::drawEllipse(int xCenter, int yCenter, int xRadius, int yRadius,
+		      byte bGraphicsMode)
 {
-    drawLine(x1, y1, x2, y1, bGraphicsMode);
-    drawLine(x2, y1, x2, y2, bGraphicsMode);
-    drawLine(x2, y2, x1, y2, bGraphicsMode);
-    drawLine(x1, y2, x1, y1, bGraphicsMode);
+    DMD_TRACE_SCOPE(DMD_TRACE_DRAW_ROUND);
+    if (xRadius < 0 || yRadius < 0) return;
+    drawRoundShape(xCenter, yCenter, xCenter, yCenter, xRadius, yRadius, false, bGraphicsMode);
 }
 
 /*--------------------------------------------------------------------------------------
- Draw or clear a filled box(rectangle) with a single pixel border
+ Draw or clear a filled ellipse with x and y radii at x,y centre
 --------------------------------------------------------------------------------------*/
-void DMD::drawFilledBox(int x1, int y1, int x2, int y2,
-			byte bGraphicsMode)
+void DMDCanvas::drawFilledEllipse(int xCenter, int yCenter, int xRadius, int yRadius,
+			    byte bGraphicsMode)
 {
-    for (int b = x1; b <= x2; b++) {
-	    drawLine(b, y1, b, y2, bGraphicsMode);
-    }
+    DMD_TRACE_SCOPE(DMD_TRACE_DRAW_ROUND);
+    if (xRadius < 0 || yRadius < 0) return;
+    drawRoundShape(xCenter, yCenter, xCenter, yCenter, xRadius, yRadius, true, bGraphicsMode);
 }
 
 /*--------------------------------------------------------------------------------------
- Draw the selected test pattern
+ Whether the pixel x,y from the centre (both >= 0) lies within a circle or ellipse of
+ radii a,b. Circles keep the rounding of the midpoint algorithm drawCircle has always
+ used, ellipses allow the same half pixel of slack along their larger radius.
 --------------------------------------------------------------------------------------*/
-void DMD::drawTestPattern(byte bPattern)
+static boolean insideRound(long x, long y, long a, long b)
 {
-    unsigned int ui;
-
-    int numPixels=DisplaysTotal * DMD_PIXELS_ACROSS * DMD_PIXELS_DOWN;
-    int pixelsWide=DMD_PIXELS_ACROSS*DisplaysWide;
-    for (ui = 0; ui < numPixels; ui++) {
-	    switch (bPattern) {
-	    case PATTERN_ALT_0:	// every alternate pixel, first pixel on
-		    if ((ui & pixelsWide) == 0)
-		        //even row
-		        writePixel((ui & (pixelsWide-1)), ((ui & ~(pixelsWide-1)) / pixelsWide), GRAPHICS_NORMAL, ui & 1);
-		    else
-		        //odd row
-		        writePixel((ui & (pixelsWide-1)), ((ui & ~(pixelsWide-1)) / pixelsWide), GRAPHICS_NORMAL, !(ui & 1));
-		    break;
-	    case PATTERN_ALT_1:	// every alternate pixel, first pixel off
-		    if ((ui & pixelsWide) == 0)
-		        //even row
-		        writePixel((ui & (pixelsWide-1)), ((ui & ~(pixelsWide-1)) / pixelsWide), GRAPHICS_NORMAL, !(ui & 1));
-		    else
-		        //odd row
-		        writePixel((ui & (pixelsWide-1)), ((ui & ~(pixelsWide-1)) / pixelsWide), GRAPHICS_NORMAL, ui & 1);
-		    break;
-	    case PATTERN_STRIPE_0:	// vertical stripes, first stripe on
-		    writePixel((ui & (pixelsWide-1)), ((ui & ~(pixelsWide-1)) / pixelsWide), GRAPHICS_NORMAL, ui & 1);
-		    break;
-	    case PATTERN_STRIPE_1:	// vertical stripes, first stripe off
-		    writePixel((ui & (pixelsWide-1)), ((ui & ~(pixelsWide-1)) / pixelsWide), GRAPHICS_NORMAL, !(ui & 1));
-		    break;
-        }
+    if (a == b) {
+	    return x * x + y * y - (x > y ? x : y) <= a * a - (a < 2 ? a : 2);
     }
+    unsigned long a2 = a * a;
+    unsigned long b2 = b * b;
+    return (unsigned long)(x * x) * b2 + (unsigned long)(y * y) * a2
+	    <= a2 * b2 + (unsigned long)(a * b) * (a < b ? a : b);
 }
 
 /*--------------------------------------------------------------------------------------
- Scan the dot matrix LED panel display, from the RAM mirror out to the display hardware.
- Call 4 times to scan the whole display which is made up of 4 interleaved rows within the 16 total rows.
+ Half width of the row dy rows from the centre of a round shape, -1 past its top or
+ bottom. x is the half width of a neighbouring row so the walk from it is short
+--------------------------------------------------------------------------------------*/
+static int roundHalfWidth(int x, int dy, int a, int b)
+{
+    if (dy > b) return -1;
+    if (x < 0) x = 0;
+    while (x > 0 && !insideRound(x, dy, a, b)) x--;
+    while (x < a && insideRound(x + 1, dy, a, b)) x++;
+    return x;
+}
+
+/*--------------------------------------------------------------------------------------
+ Draw a circle, ellipse or rounded box as one horizontal span per row (two for outlines).
+ The shape is an ellipse of radii a,b split apart at its centre so that its middle covers
+ x1..x2 and y1..y2. Outline pixels are the filled pixels next to a pixel outside the
+ shape, so every pixel is written exactly once and the outline matches the filled shape
+--------------------------------------------------------------------------------------*/
+void DMDCanvas::drawRoundShape(int x1, int y1, int x2, int y2, int a, int b, boolean filled,
+			 byte bGraphicsMode)
+{
+    int above = -1;
+    int wide = roundHalfWidth(0, b, a, b);
+
+    for (int y = y1 - b; y <= y2 + b; y++) {
+	    int dy = (y + 1 < y1) ? y1 - (y + 1) : ((y + 1 > y2) ? (y + 1) - y2 : 0);
+	    int below = roundHalfWidth(wide, dy, a, b);
+	    if (filled) {
+	        writeSpan(x1 - wide, x2 + wide, y, bGraphicsMode);
+	    } else {
+	        // pixels within the narrower neighbouring row are inside the shape
+	        int inner = ((above < below) ? above : below) + 1;
+	        if (inner > wide) inner = wide;
+	        if (above < 0 || below < 0 || x1 - inner + 1 >= x2 + inner) {
+		        writeSpan(x1 - wide, x2 + wide, y, bGraphicsMode);
+	        } else {
+		        writeSpan(x1 - wide, x1 - inner, y, bGraphicsMode);
+		        writeSpan(x2 + inner, x2 + wide, y, bGraphicsMode);
+	        }
+	    }
+	    above = wide;
+	    wide = below;
+    }
+}
+
+/*--------------------------------------------------------------------------------------
+ Draw or clear a horizontal run of pixels from x1 to x2 on row bY, a byte at a time
+--------------------------------------------------------------------------------------*/
+void DMDCanvas::writeSpan(int x1, int x2, int bY, byte bGraphicsMode)
+{
+    DISPATCH_MODE(bGraphicsMode, writeSpan, (x1, x2, bY));
+}
+
+template <byte MODE>
+void DMDCanvas::writeSpan(int x1, int x2, int bY)
+{
+    bY += clip.originY;
+    if (bY < clip.y1 || bY > clip.y2) return;
+    if (x1 > x2) {
+	    int t = x1;
+	    x1 = x2;
+	    x2 = t;
+    }
+    x1 += clip.originX;
+    x2 += clip.originX;
+    if (x1 < clip.x1) x1 = clip.x1;
+    if (x2 > clip.x2) x2 = clip.x2;
+    if (x1 > x2) return;
+
+    byte *ram = bDMDScreenRAM + rowOffset(bY);
+    int first = x1 >> 3;
+    int last = x2 >> 3;
+    byte firstMask = 0xFF >> (x1 & 0x07);
+    byte lastMask = 0xFF << (7 - (x2 & 0x07));
+    markDirtyBytes(bY, first, last);
+    if (first == last) {
+	    DMDRasterOp<MODE>::apply(ram + first, firstMask & lastMask, 0xFF);
+	    return;
+    }
+    DMDRasterOp<MODE>::apply(ram + first, firstMask, 0xFF);
+    // whole bytes in between
+    switch (MODE) {
+    case GRAPHICS_NORMAL:
+    case GRAPHICS_OR:
+	    memset(ram + first + 1, 0x00, last - first - 1);	// zero bit is pixel on
+	    break;
+    case GRAPHICS_INVERSE:
+    case GRAPHICS_NOR:
+	    memset(ram + first + 1, 0xFF, last - first - 1);	// one bit is pixel off
+	    break;
+    case GRAPHICS_TOGGLE:
+	    for (int i = first + 1; i < last; i++)
+		    ram[i] = ~ram[i];
+	    break;
+    }
+    DMDRasterOp<MODE>::apply(ram + last, lastMask, 0xFF);
+}
+
+/*--------------------------------------------------------------------------------------
+ Draw or clear a vertical run of pixels from y1 to y2 in column bX, stepping through DMD
+ RAM by the row stride and only recalculating the offset at each panel boundary
+--------------------------------------------------------------------------------------*/
+void DMDCanvas::writeColumn(int bX, int y1, int y2, byte bGraphicsMode)
+{
+    DISPATCH_MODE(bGraphicsMode, writeColumn, (bX, y1, y2));
+}
+
+template <byte MODE>
+void DMDCanvas::writeColumn(int bX, int y1, int y2)
+{
+    bX += clip.originX;
+    if (bX < clip.x1 || bX > clip.x2) return;
+    if (y1 > y2) {
+	    int t = y1;
+	    y1 = y2;
+	    y2 = t;
+    }
+    y1 += clip.originY;
+    y2 += clip.originY;
+    if (y1 < clip.y1) y1 = clip.y1;
+    if (y2 > clip.y2) y2 = clip.y2;
+
+    byte mask = bPixelLookupTable[bX & 0x07];
+    DMDRamOffset stride = rowStride;
+    markDirtyRows(y1, y2, bX >> 3, bX >> 3);
+    while (y1 <= y2) {
+	    byte *ram = bDMDScreenRAM + rowOffset(y1) + (bX >> 3);
+	    int end = y1 - (y1 % DMD_PIXELS_DOWN) + DMD_PIXELS_DOWN - 1;	// last row of this panel
+	    if (end > y2) end = y2;
+	    for (; y1 <= end; y1++, ram += stride)
+	        DMDRasterOp<MODE>::apply(ram, mask, mask);
+    }
+}
+
+/*--------------------------------------------------------------------------------------
+ Draw or clear a box(rectangle) with corners rounded to radius
+--------------------------------------------------------------------------------------*/
+void DMDCanvas::drawRoundedBox(int x1, int y1, int x2, int y2, int radius,
+			 byte bGraphicsMode)
+{
+    DMD_TRACE_SCOPE(DMD_TRACE_DRAW_BOX);
+    drawRoundedBoxShape(x1, y1, x2, y2, radius, false, bGraphicsMode);
+}
+
+/*--------------------------------------------------------------------------------------
+ Draw or clear a filled box(rectangle) with corners rounded to radius
+--------------------------------------------------------------------------------------*/
+void DMDCanvas::drawFilledRoundedBox(int x1, int y1, int x2, int y2, int radius,
+			       byte bGraphicsMode)
+{
+    DMD_TRACE_SCOPE(DMD_TRACE_DRAW_BOX);
+    drawRoundedBoxShape(x1, y1, x2, y2, radius, true, bGraphicsMode);
+}
+
+void DMDCanvas::drawRoundedBoxShape(int x1, int y1, int x2, int y2, int radius, boolean filled,
+			      byte bGraphicsMode)
+{
+    if (x1 > x2) {
+	    int t = x1;
+	    x1 = x2;
+	    x2 = t;
+    }
+    if (y1 > y2) {
+	    int t = y1;
+	    y1 = y2;
+	    y2 = t;
+    }
+    // the corners can at most meet in the middle of the shorter side
+    if (radius > (x2 - x1) / 2) radius = (x2 - x1) / 2;
+    if (radius > (y2 - y1) / 2) radius = (y2 - y1) / 2;
+    if (radius < 0) radius = 0;
+    drawRoundShape(x1 + radius, y1 + radius, x2 - radius, y2 - radius, radius, radius, filled,
+		   bGraphicsMode);
+}
+
+/*--------------------------------------------------------------------------------------
+ Draw or clear a box(rectangle) with a single pixel border
+--------------------------------------------------------------------------------------*/
+void DMDCanvas::drawBox(int x1, int y1, int x2, int y2, byte bGraphicsMode)
+{
+    DMD_TRACE_SCOPE(DMD_TRACE_DRAW_BOX);
+    if (x1 > x2) {
+	    int t = x1;
+	    x1 = x2;
+	    x2 = t;
+    }
+    if (y1 > y2) {
+	    int t = y1;
+	    y1 = y2;
+	    y2 = t;
+    }
+    // each pixel of the border is written once, so GRAPHICS_TOGGLE keeps the corners
+    writeSpan(x1, x2, y1, bGraphicsMode);
+    if (y2 > y1)
+	    writeSpan(x1, x2, y2, bGraphicsMode);
+    if (y2 - y1 > 1) {
+	    writeColumn(x1, y1 + 1, y2 - 1, bGraphicsMode);
+	    if (x2 > x1)
+	        writeColumn(x2, y1 + 1, y2 - 1, bGraphicsMode);
+    }
+}
+
+/*--------------------------------------------------------------------------------------
+ Draw or clear a filled box(rectangle) with a single pixel border
+--------------------------------------------------------------------------------------*/
+void DMDCanvas::drawFilledBox(int x1, int y1, int x2, int y2,
+			byte bGraphicsMode)
+{
+    DMD_TRACE_SCOPE(DMD_TRACE_DRAW_BOX);
+    if (x1 > x2) return;
+    if (y1 > y2) {
+	    int t = y1;
+	    y1 = y2;
+	    y2 = t;
+    }
+    // rows outside the clip rectangle draw nothing
+    if (y1 < clip.y1 - clip.originY) y1 = clip.y1 - clip.originY;
+    if (y2 > clip.y2 - clip.originY) y2 = clip.y2 - clip.originY;
+    for (int y = y1; y <= y2; y++) {
+	    writeSpan(x1, x2, y, bGraphicsMode);
+    }
+}
+
+/*--------------------------------------------------------------------------------------
+ Draw or clear a polygon outline through numPoints x,y pairs held in points
+--------------------------------------------------------------------------------------*/
+void DMDCanvas::drawPolygon(const int *points, byte numPoints, byte bGraphicsMode)
+{
+    DMD_TRACE_SCOPE(DMD_TRACE_DRAW_POLYGON);
+    for (byte i = 0; i < numPoints; i++) {
+	    byte j = (i + 1 < numPoints) ? i + 1 : 0;
+	    drawLine(points[i * 2], points[i * 2 + 1], points[j * 2], points[j * 2 + 1], bGraphicsMode);
+    }
+}
+
+//Polygon edge for the scanline fill, x and slope are 16.16 fixed point
+struct DMDPolygonEdge
+{
+    int yTop;
+    int yBottom;
+    long x;
+    long slope;
+};
+
+//Inclusive run of pixels on one row of a filled polygon
+struct DMDPolygonSpan
+{
+    int x1;
+    int x2;
+};
+
+static void sortCrossings(long *xs, byte count)
+{
+    for (byte i = 1; i < count; i++) {
+	    long x = xs[i];
+	    byte j = i;
+	    for (; j > 0 && xs[j - 1] > x; j--)
+		    xs[j] = xs[j - 1];
+	    xs[j] = x;
+    }
+}
+
+//Pair up the sorted crossings of a row into spans, rounding the fixed point x to pixels
+static byte pairCrossings(const long *xs, byte count, DMDPolygonSpan *spans, byte numSpans)
+{
+    for (byte i = 0; i + 1 < count; i += 2) {
+	    spans[numSpans].x1 = (xs[i] + 0x8000L) >> 16;
+	    spans[numSpans].x2 = (xs[i + 1] + 0x8000L) >> 16;
+	    numSpans++;
+    }
+    return numSpans;
+}
+
+/*--------------------------------------------------------------------------------------
+ Draw or clear a filled polygon with an edge table scanline fill. Edges are sorted by
+ their top row and become active as the scan reaches them, each row pairs up the
+ crossings of the active edges (even-odd rule) into spans written a byte at a time.
+ Rows are clipped to the display before any edge is stepped.
+
+ Every row is paired twice, once counting edges that start on the row and once counting
+ edges that end on it, and the spans of both are merged together with any horizontal
+ edges on the row. That keeps rows through vertices inclusive, so single points, bottom
+ edges and the tips of arrows are filled rather than lost to a half open edge rule.
+--------------------------------------------------------------------------------------*/
+void DMDCanvas::drawFilledPolygon(const int *points, byte numPoints, byte bGraphicsMode)
+{
+    DMD_TRACE_SCOPE(DMD_TRACE_DRAW_POLYGON);
+    DMDPolygonEdge edges[DMD_MAX_POLYGON_POINTS];
+    DMDPolygonSpan spans[DMD_MAX_POLYGON_POINTS * 2];
+    long crossingsDown[DMD_MAX_POLYGON_POINTS];
+    long crossingsUp[DMD_MAX_POLYGON_POINTS];
+
+    if (numPoints == 0 || numPoints > DMD_MAX_POLYGON_POINTS) return;
+
+    // build the edge table sorted by top row
+    int yMin = points[1];
+    int yMax = points[1];
+    for (byte i = 0; i < numPoints; i++) {
+	    byte j = (i + 1 < numPoints) ? i + 1 : 0;
+	    int x1 = points[i * 2], y1 = points[i * 2 + 1];
+	    int x2 = points[j * 2], y2 = points[j * 2 + 1];
+	    if (y1 > y2) {
+	        int t = x1; x1 = x2; x2 = t;
+	        t = y1; y1 = y2; y2 = t;
+	    }
+	    if (y1 < yMin) yMin = y1;
+	    if (y2 > yMax) yMax = y2;
+
+	    DMDPolygonEdge edge;
+	    edge.yTop = y1;
+	    edge.yBottom = y2;
+	    edge.x = (long)x1 * 65536L;
+	    // horizontal edges keep their other end in slope
+	    edge.slope = (y1 == y2) ? ((long)x2 * 65536L) : ((long)(x2 - x1) * 65536L / (y2 - y1));
+	    byte k = i;
+	    for (; k > 0 && edges[k - 1].yTop > y1; k--)
+		    edges[k] = edges[k - 1];
+	    edges[k] = edge;
+    }
+
+    // clip the rows to the clip rectangle
+    if (yMin < clip.y1 - clip.originY) yMin = clip.y1 - clip.originY;
+    if (yMax > clip.y2 - clip.originY) yMax = clip.y2 - clip.originY;
+
+    byte active = 0;	// edges before this index have started
+    for (int y = yMin; y <= yMax; y++) {
+	    for (; active < numPoints && edges[active].yTop <= y; active++) {
+	        DMDPolygonEdge &edge = edges[active];
+	        if (edge.yTop < y && edge.yTop != edge.yBottom)
+		        edge.x += edge.slope * (y - edge.yTop);
+	    }
+
+	    byte down = 0, up = 0, numSpans = 0;
+	    for (byte i = 0; i < active; i++) {
+	        DMDPolygonEdge &edge = edges[i];
+	        if (edge.yBottom < y) continue;
+	        if (edge.yTop == edge.yBottom) {
+		        spans[numSpans].x1 = edge.x >> 16;
+		        spans[numSpans].x2 = edge.slope >> 16;
+		        numSpans++;
+		        continue;
+	        }
+	        if (y < edge.yBottom) crossingsDown[down++] = edge.x;
+	        if (y > edge.yTop) crossingsUp[up++] = edge.x;
+	        edge.x += edge.slope;
+	    }
+	    if (down == 0 && up == 0 && numSpans == 0) continue;
+
+	    sortCrossings(crossingsDown, down);
+	    numSpans = pairCrossings(crossingsDown, down, spans, numSpans);
+	    sortCrossings(crossingsUp, up);
+	    numSpans = pairCrossings(crossingsUp, up, spans, numSpans);
+
+	    // merge overlapping spans so no pixel is written twice
+	    for (byte i = 0; i < numSpans; i++) {
+	        if (spans[i].x1 > spans[i].x2) {
+		        int t = spans[i].x1;
+		        spans[i].x1 = spans[i].x2;
+		        spans[i].x2 = t;
+	        }
+	        DMDPolygonSpan span = spans[i];
+	        byte j = i;
+	        for (; j > 0 && spans[j - 1].x1 > span.x1; j--)
+		        spans[j] = spans[j - 1];
+	        spans[j] = span;
+	    }
+	    int x1 = spans[0].x1;
+	    int x2 = spans[0].x2;
+	    for (byte i = 1; i < numSpans; i++) {
+	        if (spans[i].x1 <= x2 + 1) {
+		        if (spans[i].x2 > x2) x2 = spans[i].x2;
+	        } else {
+		        writeSpan(x1, x2, y, bGraphicsMode);
+		        x1 = spans[i].x1;
+		        x2 = spans[i].x2;
+	        }
+	    }
+	    writeSpan(x1, x2, y, bGraphicsMode);
+    }
+}
+
+/*--------------------------------------------------------------------------------------
+ Draw or clear a triangle outline
+--------------------------------------------------------------------------------------*/
+void DMDCanvas::drawTriangle(int x1, int y1, int x2, int y2, int x3, int y3, byte bGraphicsMode)
+{
+    DMD_TRACE_SCOPE(DMD_TRACE_DRAW_POLYGON);
+    int points[6] = { x1, y1, x2, y2, x3, y3 };
+    drawPolygon(points, 3, bGraphicsMode);
+}
+
+/*--------------------------------------------------------------------------------------
+ Draw or clear a filled triangle
+--------------------------------------------------------------------------------------*/
+void DMDCanvas::drawFilledTriangle(int x1, int y1, int x2, int y2, int x3, int y3,
+			     byte bGraphicsMode)
+{
+    DMD_TRACE_SCOPE(DMD_TRACE_DRAW_POLYGON);
+    int points[6] = { x1, y1, x2, y2, x3, y3 };
+    drawFilledPolygon(points, 3, bGraphicsMode);
+}
+
+/*--------------------------------------------------------------------------------------
+ Draw the selected test pattern across the clip rectangle
+--------------------------------------------------------------------------------------*/
+void DMDCanvas::drawTestPattern(byte bPattern)
+{
+    DMD_TRACE_SCOPE(DMD_TRACE_TEST_PATTERN);
+    if (clip.x1 > clip.x2) return;
+    int first = clip.x1 >> 3;
+    int last = clip.x2 >> 3;
+    byte firstMask = clipMask(first);
+    byte lastMask = clipMask(last);
+
+    markDirtyRows(clip.y1, clip.y2, first, last);
+    // whole rows of bytes, zero bit is pixel on
+    for (int y = clip.y1; y <= clip.y2; y++) {
+	    byte odd;	// odd columns lit
+	    switch (bPattern) {
+	    case PATTERN_ALT_0:	// every alternate pixel, first pixel on
+		    odd = !(y & 1);
+		    break;
+	    case PATTERN_ALT_1:	// every alternate pixel, first pixel off
+		    odd = y & 1;
+		    break;
+	    case PATTERN_STRIPE_0:	// vertical stripes, first stripe on
+		    odd = true;
+		    break;
+	    case PATTERN_STRIPE_1:	// vertical stripes, first stripe off
+		    odd = false;
+		    break;
+	    default:
+		    return;
+	    }
+	    byte *ram = bDMDScreenRAM + rowOffset(y);
+	    byte pattern = odd ? 0xAA : 0x55;
+	    byte head = ram[first];
+	    byte tail = ram[last];
+	    memset(ram + first, pattern, last - first + 1);
+	    // keep the pixels either side of the clip rectangle
+	    ram[first] = (ram[first] & firstMask) | (head & ~firstMask);
+	    ram[last] = (ram[last] & lastMask) | (tail & ~lastMask);
+    }
+}
+
+/*--------------------------------------------------------------------------------------
+ Copy a canvas, or a region of one, into this canvas a destination byte at a time
+--------------------------------------------------------------------------------------*/
+void DMDCanvas::drawCanvas(int bX, int bY, DMDCanvas &canvas, byte bGraphicsMode)
+{
+    drawCanvas(bX, bY, canvas, 0, 0, canvas.pixelsWide, canvas.pixelsHigh, bGraphicsMode);
+}
+
+void DMDCanvas::drawCanvas(int bX, int bY, DMDCanvas &canvas, int srcX, int srcY, int width,
+			   int height, byte bGraphicsMode)
+{
+    DMD_TRACE_SCOPE(DMD_TRACE_DRAW_CANVAS);
+    DISPATCH_MODE(bGraphicsMode, blitCanvas, (bX, bY, canvas, srcX, srcY, width, height));
+}
+
+template <byte MODE>
+void DMDCanvas::blitCanvas(int bX, int bY, DMDCanvas &canvas, int srcX, int srcY, int width,
+			   int height)
+{
+    bX += clip.originX;
+    bY += clip.originY;
+    // clip the region to the source canvas and then to the clip rectangle
+    if (srcX < 0) {
+	    bX -= srcX;
+	    width += srcX;
+	    srcX = 0;
+    }
+    if (srcY < 0) {
+	    bY -= srcY;
+	    height += srcY;
+	    srcY = 0;
+    }
+    if (width > canvas.pixelsWide - srcX) width = canvas.pixelsWide - srcX;
+    if (height > canvas.pixelsHigh - srcY) height = canvas.pixelsHigh - srcY;
+    if (bX < clip.x1) {
+	    srcX += clip.x1 - bX;
+	    width -= clip.x1 - bX;
+	    bX = clip.x1;
+    }
+    if (bY < clip.y1) {
+	    srcY += clip.y1 - bY;
+	    height -= clip.y1 - bY;
+	    bY = clip.y1;
+    }
+    if (width > clip.x2 + 1 - bX) width = clip.x2 + 1 - bX;
+    if (height > clip.y2 + 1 - bY) height = clip.y2 + 1 - bY;
+    if (width <= 0 || height <= 0) return;
+
+    int first = bX >> 3;
+    int last = (bX + width - 1) >> 3;
+    byte firstMask = 0xFF >> (bX & 0x07);
+    byte lastMask = 0xFF << (7 - ((bX + width - 1) & 0x07));
+    int offset = srcX - bX;	// source x of destination x 0
+    // source and destination bytes line up, so whole bytes between the ends can be copied
+    boolean aligned = (MODE == GRAPHICS_NORMAL) && (offset & 0x07) == 0 && last - first > 1;
+    markDirtyRows(bY, bY + height - 1, first, last);
+
+    for (int r = 0; r < height; r++) {
+	    const byte *src = canvas.bDMDCanvasRAM + canvas.rowOffset(srcY + r);
+	    byte *ram = bDMDScreenRAM + rowOffset(bY + r);
+	    if (first == last) {
+	        DMDRasterOp<MODE>::apply(ram + first, firstMask & lastMask,
+				     ~readPixels(src, offset + (first << 3), canvas.bytesWide));
+	        continue;
+	    }
+	    DMDRasterOp<MODE>::apply(ram + first, firstMask,
+				 ~readPixels(src, offset + (first << 3), canvas.bytesWide));
+	    if (aligned) {
+	        memcpy(ram + first + 1, src + offset / 8 + first + 1, last - first - 1);
+	    } else {
+	        for (int b = first + 1; b < last; b++)
+		        DMDRasterOp<MODE>::apply(ram + b, 0xFF, ~readPixels(src, offset + (b << 3), canvas.bytesWide));
+	    }
+	    DMDRasterOp<MODE>::apply(ram + last, lastMask,
+				 ~readPixels(src, offset + (last << 3), canvas.bytesWide));
+    }
+}
+
+volatile byte DMD::spiLocks = 0;
+DMD * volatile DMD::deferredScan = NULL;
+
+/*--------------------------------------------------------------------------------------
+ SPI bus locking. A scan run from the timer interrupt can not be cut into by a lock taken
+ in the main loop, and unlockSPI() runs a deferred scan with interrupts still off so the
+ timer can not cut into it either. Both restore rather than enable interrupts on AVR, so
+ they can be called from an interrupt or inside the caller's own critical section
+--------------------------------------------------------------------------------------*/
+void DMD::lockSPI()
+{
+#if defined(__AVR__)
+    byte sreg = SREG;
+    cli();
+#else
+    noInterrupts();
+#endif
+    spiLocks++;
+#if defined(__AVR__)
+    SREG = sreg;
+#else
+    interrupts();
+#endif
+}
+
+void DMD::unlockSPI()
+{
+#if defined(__AVR__)
+    byte sreg = SREG;
+    cli();
+#else
+    noInterrupts();
+#endif
+    if (spiLocks > 0 && --spiLocks == 0 && deferredScan != NULL) {
+	    DMD *dmd = deferredScan;
+	    deferredScan = NULL;
+	    dmd->scanDisplayBySPI();
+    }
+#if defined(__AVR__)
+    SREG = sreg;
+#else
+    interrupts();
+#endif
+}
+
+//Set bits in each value of a nibble, a one bit is an unlit pixel
+static const byte nibbleBits[16] = { 0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4 };
+
+static inline byte unlitPixels(byte b)
+{
+    return nibbleBits[b & 0x0F] + nibbleBits[b >> 4];
+}
+
+//Share of the time out of 255 rows with lit pixels lit can be shown for and stay within limit
+static inline byte pwmDuty(DMDRamOffset lit, DMDRamOffset limit)
+{
+    return (lit <= limit) ? 255 : (byte)(((unsigned long)limit * 255) / lit);
+}
+
+/*--------------------------------------------------------------------------------------
+ Scan the dot matrix LED panel display, from the RAM mirror out to the display hardware.
+ Call 4 times to scan the whole display which is made up of 4 interleaved rows within the 16 total rows.
  Insert the calls to this function into the main loop for the highest call rate, or from a timer interrupt
 --------------------------------------------------------------------------------------*/
 void DMD::scanDisplayBySPI()
 {
+    DMD_TRACE_SCOPE(DMD_TRACE_SCAN);
+    //the bus is locked, unlockSPI() runs this scan when it is free
+    if (spiLocks > 0) {
+        deferredScan = this;
+        return;
+    }
     //if PIN_OTHER_SPI_nCS is in use during a DMD scan request then scanDisplayBySPI() will exit without conflict! (and skip that scan)
     if( digitalRead( PIN_OTHER_SPI_nCS ) == HIGH )
     {
-        //SPI transfer pixels to the display hardware shift registers
-        int rowsize=DisplaysTotal<<2;
-        int offset=rowsize * bDMDByte;
-        for (int i=0;i<rowsize;i++) {
-            SPI.transfer(bDMDScreenRAM[offset+i+row3]);
-            SPI.transfer(bDMDScreenRAM[offset+i+row2]);
-            SPI.transfer(bDMDScreenRAM[offset+i+row1]);
-            SPI.transfer(bDMDScreenRAM[offset+i]);
+        //change page only between whole scans of the display
+        if (bDMDByte == 0 && nextPage != shownPage) {
+            shownPage = nextPage;
+            bDMDDisplayRAM = bDMDPageRAM + shownPage * getScreenRAMSize();
         }
 
+        //SPI transfer pixels to the display hardware shift registers, counting the lit ones on the way
+        DMDRamOffset rowsize=(DMDRamOffset)DisplaysTotal<<2;
+        DMDRamOffset offset=rowsize * bDMDByte;
+        DMDRamOffset limit=powerLimit;
+#ifdef SPI_HAS_TRANSACTION
+        //the DMD's own bus settings. endTransaction() does not put back those of a device the scan
+        //interrupted, so on AVR they are saved here, elsewhere other devices must use transactions too
+#if defined(SPCR)
+        byte spcr=SPCR;
+        byte spsr=SPSR;
+#endif
+        SPI.beginTransaction(SPISettings(DMD_SPI_CLOCK, MSBFIRST, SPI_MODE0));
+#endif
+        if (limit == 0) {
+            for (DMDRamOffset i=0;i<rowsize;i++) {
+                const byte *ram=bDMDDisplayRAM+offset+i;
+                SPI.transfer(ram[row3]);
+                SPI.transfer(ram[row2]);
+                SPI.transfer(ram[row1]);
+                SPI.transfer(ram[0]);
+            }
+        } else {
+            //only pay for counting when there is a limit to keep to
+            DMDRamOffset unlit=0;
+            for (DMDRamOffset i=0;i<rowsize;i++) {
+                const byte *ram=bDMDDisplayRAM+offset+i;
+                SPI.transfer(ram[row3]);
+                SPI.transfer(ram[row2]);
+                SPI.transfer(ram[row1]);
+                SPI.transfer(ram[0]);
+                unlit += unlitPixels(ram[row3]) + unlitPixels(ram[row2]) + unlitPixels(ram[row1]) + unlitPixels(ram[0]);
+            }
+            litPixels[bDMDByte]=(rowsize<<5) - unlit;
+        }
+#ifdef SPI_HAS_TRANSACTION
+        SPI.endTransaction();
+#if defined(SPCR)
+        SPCR=spcr;
+        SPSR=spsr;
+#endif
+#endif
+        byte group=bDMDByte;
+
         OE_DMD_ROWS_OFF();
         LATCH_DMD_SHIFT_REG_TO_OUTPUT();
         switch (bDMDByte) {
@@ -451,19 +1691,83 @@ void DMD::scanDisplayBySPI()
             bDMDByte=0;
             break;
         }
-        OE_DMD_ROWS_ON();
+        if (limit == 0 || litPixels[group] <= limit) {
+            OE_DMD_ROWS_ON();
+        } else {
+            OE_DMD_ROWS_PWM();
+        }
+        if (limit != 0) {
+            //the timer takes the duty when this period ends, so set it for the group the next scan lights,
+            //from that group's count the last time round
+            OE_DMD_PWM_DUTY(pwmDuty(litPixels[bDMDByte], limit));
+        }
     }
 }
 
-void DMD::selectFont(const uint8_t * font)
+DMDRamOffset DMD::getLitPixels(byte group)
+{
+    if (group >= 4) return 0;
+    noInterrupts();
+    DMDRamOffset lit = litPixels[group];
+    interrupts();
+    return lit;
+}
+
+DMDRamOffset DMD::getLitPixels()
+{
+    DMDRamOffset lit = 0;
+    for (byte g = 0; g < 4; g++)
+	    lit += getLitPixels(g);
+    return lit;
+}
+
+/*--------------------------------------------------------------------------------------
+ Power limiting, the scan lights a row group whose lit count is over the limit for only
+ part of the time. The count is taken from the pixels the scan has just sent, whatever
+ drew them. The PWM duty is set a scan ahead from the group's previous count, so a
+ group a new image takes over the limit is shown fully on for one scan before dimming
+--------------------------------------------------------------------------------------*/
+void DMD::setPowerLimit(DMDRamOffset maxLit)
+{
+    noInterrupts();
+    powerLimit = maxLit;
+    if (maxLit == 0) {
+	    // no longer counted
+	    for (byte g = 0; g < 4; g++)
+		    litPixels[g] = 0;
+    }
+    interrupts();
+}
+
+DMDRamOffset DMD::getPowerLimit()
+{
+    return powerLimit;
+}
+
+void DMDCanvas::selectFont(const uint8_t * font)
 {
     this->Font = font;
+    this->rowFont = (font != NULL && pgm_read_byte(font + FONT_LENGTH) == FONT_ROW_MAGIC_0
+	    && pgm_read_byte(font + FONT_LENGTH + 1) == FONT_ROW_MAGIC_1);
+}
+
+const uint8_t* DMDCanvas::getFont()
+{
+    return this->Font;
 }
 
 
-int DMD::drawChar(const int bX, const int bY, const unsigned char letter, byte bGraphicsMode)
+int DMDCanvas::drawChar(const int bX, const int bY, const unsigned char letter, byte bGraphicsMode)
+{
+    DMD_TRACE_SCOPE(DMD_TRACE_DRAW_CHAR);
+    DISPATCH_MODE(bGraphicsMode, return drawChar, (bX, bY, letter));
+    return 0;
+}
+
+template <byte MODE>
+int DMDCanvas::drawChar(const int bX, const int bY, const unsigned char letter)
 {
-    if (bX > (DMD_PIXELS_ACROSS*DisplaysWide) || bY > (DMD_PIXELS_DOWN*DisplaysHigh) ) return -1;
+    if (bX + clip.originX > clip.x2 + 1 || bY + clip.originY > clip.y2 + 1) return -1;
     unsigned char c = letter;
     uint8_t height = pgm_read_byte(this->Font + FONT_HEIGHT);
     if (c == ' ') {
@@ -471,6 +1775,10 @@ int DMD::drawChar(const int bX, const int bY, const unsigned char letter, byte b
 	    this->drawFilledBox(bX, bY, bX + charWide, bY + height, GRAPHICS_INVERSE);
 	    return charWide;
     }
+    if (rowFont) {
+	    const uint8_t *glyph = rowFontGlyph(c);
+	    return glyph ? drawRowFontChar<MODE>(bX, bY, glyph) : 0;
+    }
     uint8_t width = 0;
     uint8_t bytes = (height + 7) / 8;
 
@@ -480,22 +1788,21 @@ int DMD::drawChar(const int bX, const int bY, const unsigned char letter, byte b
     uint16_t index = 0;
 
     if (c < firstChar || c >= (firstChar + charCount)) return 0;
-    c -= firstChar;
 
-    if (pgm_read_byte(this->Font + FONT_LENGTH) == 0
-	    && pgm_read_byte(this->Font + FONT_LENGTH + 1) == 0) {
-	    // zero length is flag indicating fixed width font (array does not contain width data entries)
-	    width = pgm_read_byte(this->Font + FONT_FIXED_WIDTH);
-	    index = c * bytes * width + FONT_WIDTH_TABLE;
-    } else {
-	    // variable width font, read width data, to get the index
-	    for (uint8_t i = 0; i < c; i++) {
-	        index += pgm_read_byte(this->Font + FONT_WIDTH_TABLE + i);
-	    }
-	    index = index * bytes + charCount + FONT_WIDTH_TABLE;
-	    width = pgm_read_byte(this->Font + FONT_WIDTH_TABLE + c);
+    if (glyphCache) {
+        // pre-rendered glyph, blitted a byte at a time
+        DMDGlyphCacheSlot *slot = cachedGlyph(letter);
+        if (slot) {
+            width = slot->width;
+            if (bX + clip.originX < clip.x1 - width || bY + clip.originY < clip.y1 - height) return width;
+            blitGlyph<MODE>(bX, bY, (const byte *)(slot + 1), width, glyphRows(height));
+            return width;
+        }
     }
-    if (bX < -width || bY < -height) return width;
+
+    c -= firstChar;
+    index = glyphIndex(c, &width);
+    if (bX + clip.originX < clip.x1 - width || bY + clip.originY < clip.y1 - height) return width;
 
     // last but not least, draw the character
     for (uint8_t j = 0; j < width; j++) { // Width
@@ -507,11 +1814,7 @@ int DMD::drawChar(const int bX, const int bY, const unsigned char letter, byte b
             }
 	        for (uint8_t k = 0; k < 8; k++) { // Vertical bits
 		        if ((offset+k >= i*8) && (offset+k <= height)) {
-		            if (data & (1 << k)) {
-			            writePixel(bX + j, bY + offset + k, bGraphicsMode, true);
-		            } else {
-			            writePixel(bX + j, bY + offset + k, bGraphicsMode, false);
-		            }
+		            writePixel<MODE>(bX + j, bY + offset + k, data & (1 << k));
 		        }
 	        }
 	    }
@@ -519,13 +1822,18 @@ int DMD::drawChar(const int bX, const int bY, const unsigned char letter, byte b
     return width;
 }
 
-int DMD::charWidth(const unsigned char letter)
+int DMDCanvas::charWidth(const unsigned char letter)
 {
     unsigned char c = letter;
     // Space is often not included in font so use width of 'n'
     if (c == ' ') c = 'n';
     uint8_t width = 0;
 
+    if (rowFont) {
+	    const uint8_t *glyph = rowFontGlyph(c);
+	    return glyph ? pgm_read_byte(glyph) : 0;
+    }
+
     uint8_t firstChar = pgm_read_byte(this->Font + FONT_FIRST_CHAR);
     uint8_t charCount = pgm_read_byte(this->Font + FONT_CHAR_COUNT);
 
@@ -546,3 +1854,332 @@ int DMD::charWidth(const unsigned char letter)
     }
     return width;
 }
+
+/*--------------------------------------------------------------------------------------
+ Unicode glyphs. FontCreator fonts cover one range of code points up to 0xFF, read as
+ Latin-1, row fonts any number of ranges found by binary search. A code point the font
+ has no glyph for is drawn as U+FFFD if the font has it, otherwise as '?'
+--------------------------------------------------------------------------------------*/
+boolean DMDCanvas::hasGlyph(uint16_t code)
+{
+    if (code == ' ') return true;	// drawn as a blank the width of 'n'
+    if (rowFont) return rowFontGlyph(code) != NULL;
+    uint8_t firstChar = pgm_read_byte(this->Font + FONT_FIRST_CHAR);
+    uint8_t charCount = pgm_read_byte(this->Font + FONT_CHAR_COUNT);
+    return code >= firstChar && code < firstChar + charCount && code <= 0xFF;
+}
+
+uint16_t DMDCanvas::fontCodePoint(uint16_t code)
+{
+    if (hasGlyph(code)) return code;
+    return hasGlyph(DMD_REPLACEMENT_CHAR) ? DMD_REPLACEMENT_CHAR : '?';
+}
+
+int DMDCanvas::drawGlyph(const int bX, const int bY, uint16_t code, byte bGraphicsMode)
+{
+    DMD_TRACE_SCOPE(DMD_TRACE_DRAW_GLYPH);
+    code = fontCodePoint(code);
+    if (code <= 0xFF) return drawChar(bX, bY, code, bGraphicsMode);
+    if (bX + clip.originX > clip.x2 + 1 || bY + clip.originY > clip.y2 + 1) return -1;
+    // only row fonts have glyphs past 0xFF
+    DISPATCH_MODE(bGraphicsMode, return drawRowFontChar, (bX, bY, rowFontGlyph(code)));
+    return 0;
+}
+
+int DMDCanvas::glyphWidth(uint16_t code)
+{
+    code = fontCodePoint(code);
+    if (code <= 0xFF) return charWidth(code);
+    return pgm_read_byte(rowFontGlyph(code));
+}
+
+/*--------------------------------------------------------------------------------------
+ Glyph cache, recently drawn glyphs are kept pre-rendered in RAM in the framebuffer's bit
+ order and polarity so drawChar can blit them a byte at a time instead of decoding the
+ column based font data from PROGMEM pixel by pixel. Slots are direct mapped by character
+ and sized for the widest glyph of the font in use when the cache is first filled, glyphs
+ of larger fonts are drawn uncached.
+--------------------------------------------------------------------------------------*/
+void DMDCanvas::setGlyphCacheSize(unsigned int bytes)
+{
+    free(glyphCache);
+    glyphCache = NULL;
+    glyphCacheSize = 0;
+    if (bytes > 0) {
+        glyphCache = (byte *) malloc(bytes);
+        if (glyphCache)
+            glyphCacheSize = bytes;
+    }
+    glyphCacheSlots = 0;
+    glyphCacheSlotBytes = 0;
+}
+
+unsigned long DMDCanvas::getGlyphCacheHits()
+{
+    return glyphCacheHits;
+}
+
+unsigned long DMDCanvas::getGlyphCacheMisses()
+{
+    return glyphCacheMisses;
+}
+
+void DMDCanvas::resetGlyphCacheStats()
+{
+    glyphCacheHits = 0;
+    glyphCacheMisses = 0;
+}
+
+/*--------------------------------------------------------------------------------------
+ Lay the cache slots out for the widest glyph of the current font, emptying them, unless
+ they are already big enough for it. Returns whether the layout changed
+--------------------------------------------------------------------------------------*/
+boolean DMDCanvas::layoutGlyphCache(uint8_t rows)
+{
+    uint8_t widest = pgm_read_byte(this->Font + FONT_FIXED_WIDTH);
+    if (pgm_read_byte(this->Font + FONT_LENGTH) != 0
+	|| pgm_read_byte(this->Font + FONT_LENGTH + 1) != 0) {
+	    uint8_t charCount = pgm_read_byte(this->Font + FONT_CHAR_COUNT);
+	    widest = 0;
+	    for (uint8_t i = 0; i < charCount; i++) {
+	        uint8_t w = pgm_read_byte(this->Font + FONT_WIDTH_TABLE + i);
+	        if (w > widest) widest = w;
+	    }
+    }
+    // keep every slot header aligned for the pointer it holds
+    unsigned int slotBytes = ((widest + 7) / 8) * rows;
+    slotBytes = (slotBytes + sizeof(const uint8_t *) - 1) & ~(sizeof(const uint8_t *) - 1);
+    if (slotBytes == 0 || slotBytes > 255 || slotBytes <= glyphCacheSlotBytes) return false;
+    glyphCacheSlotBytes = slotBytes;
+    unsigned int slots = glyphCacheSize / (sizeof(DMDGlyphCacheSlot) + glyphCacheSlotBytes);
+    glyphCacheSlots = (slots > 255) ? 255 : slots;
+    for (byte s = 0; s < glyphCacheSlots; s++)
+        ((DMDGlyphCacheSlot *)(glyphCache + s * (sizeof(DMDGlyphCacheSlot) + glyphCacheSlotBytes)))->font = NULL;
+    return true;
+}
+
+DMDGlyphCacheSlot *DMDCanvas::cachedGlyph(const unsigned char letter)
+{
+    uint8_t height = pgm_read_byte(this->Font + FONT_HEIGHT);
+    uint8_t rows = glyphRows(height);
+    uint8_t firstChar = pgm_read_byte(this->Font + FONT_FIRST_CHAR);
+
+    if (glyphCacheSlotBytes == 0) layoutGlyphCache(rows);
+    if (glyphCacheSlots == 0) return NULL;
+
+    DMDGlyphCacheSlot *slot = (DMDGlyphCacheSlot *)(glyphCache +
+        (letter % glyphCacheSlots) * (sizeof(DMDGlyphCacheSlot) + glyphCacheSlotBytes));
+    if (slot->font == this->Font && slot->letter == letter) {
+        glyphCacheHits++;
+        return slot;
+    }
+    glyphCacheMisses++;
+
+    uint8_t width;
+    uint8_t bytes = (height + 7) / 8;
+    uint16_t index = glyphIndex(letter - firstChar, &width);
+    uint8_t stride = (width + 7) / 8;
+    if (stride * rows > glyphCacheSlotBytes) {
+        // a wider or taller font than the slots were laid out for, lay them out again for it
+        if (!layoutGlyphCache(rows) || glyphCacheSlots == 0) return NULL;
+        slot = (DMDGlyphCacheSlot *)(glyphCache +
+            (letter % glyphCacheSlots) * (sizeof(DMDGlyphCacheSlot) + glyphCacheSlotBytes));
+    }
+
+    // render the column based font data into rows, one bit is pixel on
+    byte *bitmap = (byte *)(slot + 1);
+    memset(bitmap, 0x00, stride * rows);
+    for (uint8_t j = 0; j < width; j++) { // Width
+	    for (uint8_t i = bytes - 1; i < 254; i--) { // Vertical Bytes
+	        uint8_t data = pgm_read_byte(this->Font + index + j + (i * width));
+		    int offset = (i * 8);
+		    if ((i == bytes - 1) && bytes > 1) {
+		        offset = height - 8;
+            }
+	        for (uint8_t k = 0; k < 8; k++) { // Vertical bits
+		        if ((offset+k >= i*8) && (offset+k <= height) && (data & (1 << k))) {
+		            bitmap[(offset + k) * stride + (j >> 3)] |= bPixelLookupTable[j & 0x07];
+		        }
+	        }
+	    }
+    }
+    slot->font = this->Font;
+    slot->letter = letter;
+    slot->width = width;
+    return slot;
+}
+
+/*--------------------------------------------------------------------------------------
+ Blit a cached glyph bitmap to DMD RAM at any pixel position, a row at a time
+--------------------------------------------------------------------------------------*/
+template <byte MODE>
+void DMDCanvas::blitGlyph(int bX, int bY, const byte *bitmap, uint8_t width, uint8_t rows)
+{
+    uint8_t stride = (width + 7) / 8;
+
+    bX += clip.originX;
+    bY += clip.originY;
+    for (uint8_t r = 0; r < rows; r++, bitmap += stride) {
+        int y = bY + r;
+        if (y < clip.y1) continue;
+        if (y > clip.y2) return;
+        blitRow<MODE>(bX, y, bitmap, width);
+    }
+}
+
+/*--------------------------------------------------------------------------------------
+ Blit one row of pixels, MSB first with a one bit for each lit pixel, to DMD RAM at any
+ canvas x position a byte of the source at a time, clipped to the clip rectangle. bY is a
+ canvas row and must be inside the clip rectangle
+--------------------------------------------------------------------------------------*/
+template <byte MODE>
+void DMDCanvas::blitRow(int bX, int bY, const byte *bits, uint8_t width)
+{
+    uint8_t stride = (width + 7) / 8;
+    byte *ram = bDMDScreenRAM + rowOffset(bY);
+    int firstByte = clip.x1 >> 3;
+    int lastByte = clip.x2 >> 3;
+    int left = (bX > clip.x1) ? bX : clip.x1;
+    int right = (bX + width - 1 < clip.x2) ? bX + width - 1 : clip.x2;
+    if (left > right) return;
+    markDirtyBytes(bY, left >> 3, right >> 3);
+
+    for (uint8_t s = 0; s < stride; s++) {
+        int x = bX + (s << 3);
+        if (x <= -8) continue;
+        // destination byte and bit offset of the leftmost source pixel, rounded down for x < 0
+        int b = ((x + 8) >> 3) - 1;
+        if (b > lastByte) break;
+        byte shift = (x + 8) & 0x07;
+        byte mask = (width - (s << 3) >= 8) ? 0xFF : (byte)(0xFF << (8 - (width - (s << 3))));
+        byte on = bits[s] & mask;
+        if (b >= firstByte)
+            DMDRasterOp<MODE>::apply(ram + b, (mask >> shift) & clipMask(b), on >> shift);
+        if (shift && b + 1 <= lastByte && b + 1 >= firstByte)
+            DMDRasterOp<MODE>::apply(ram + b + 1, (byte)(mask << (8 - shift)) & clipMask(b + 1), on << (8 - shift));
+    }
+}
+
+/*--------------------------------------------------------------------------------------
+ Row fonts, compiled from FontCreator headers or BDF files by extras/dmd_fontc.py, hold
+ each glyph as rows in the framebuffer's bit order (MSB is the leftmost pixel, a one bit
+ is a lit pixel) so they are drawn with byte blits straight from PROGMEM:
+
+   0xFF 0xD5, widest glyph, font height, rows per glyph, range count
+   ranges     first code point, glyph count, number of the range's first glyph
+   offsets    offset from the start of the font to each glyph, in glyph number order
+   glyphs     width, flags, then the rows, run length coded if FONT_ROW_GLYPH_RLE is set
+              (n < 0x80 is n + 1 literal bytes, n >= 0x80 repeats the next byte n - 0x80 + 2 times)
+
+ All 16 bit values are little endian.
+--------------------------------------------------------------------------------------*/
+static inline uint16_t fontWord(const uint8_t *p)
+{
+    return pgm_read_byte(p) | ((uint16_t)pgm_read_byte(p + 1) << 8);
+}
+
+//Find a glyph of the selected row font, binary searching its code point ranges
+const uint8_t *DMDCanvas::rowFontGlyph(uint16_t code)
+{
+    uint8_t lo = 0;
+    uint8_t hi = pgm_read_byte(this->Font + FONT_ROW_RANGE_COUNT);
+
+    while (lo < hi) {
+	    uint8_t mid = (lo + hi) / 2;
+	    const uint8_t *range = this->Font + FONT_ROW_RANGES + mid * FONT_ROW_RANGE_BYTES;
+	    uint16_t first = fontWord(range);
+	    if (code < first) {
+	        hi = mid;
+	    } else if (code - first >= fontWord(range + 2)) {
+	        lo = mid + 1;
+	    } else {
+	        uint16_t glyph = fontWord(range + 4) + (code - first);
+	        const uint8_t *offsets = this->Font + FONT_ROW_RANGES
+		    + pgm_read_byte(this->Font + FONT_ROW_RANGE_COUNT) * FONT_ROW_RANGE_BYTES;
+	        return this->Font + fontWord(offsets + glyph * 2);
+	    }
+    }
+    return NULL;
+}
+
+template <byte MODE>
+int DMDCanvas::drawRowFontChar(int bX, int bY, const uint8_t *glyph)
+{
+    uint8_t width = pgm_read_byte(glyph);
+    boolean rle = pgm_read_byte(glyph + 1) & FONT_ROW_GLYPH_RLE;
+    uint8_t rows = pgm_read_byte(this->Font + FONT_ROW_GLYPH_ROWS);
+    uint8_t stride = (width + 7) / 8;
+    const uint8_t *data = glyph + 2;
+    byte row[32];
+    uint8_t run = 0;
+    boolean repeat = false;
+
+    bX += clip.originX;
+    bY += clip.originY;
+    if (bX < clip.x1 - width || bY < clip.y1 - rows || width == 0) return width;
+
+    for (uint8_t r = 0; r < rows; r++) {
+	    int y = bY + r;
+	    if (y > clip.y2) break;
+	    if (!rle) {
+	        // rows above the clip rectangle are skipped without reading them
+	        if (y >= clip.y1) {
+		        memcpy_P(row, data, stride);
+		        blitRow<MODE>(bX, y, row, width);
+	        }
+	        data += stride;
+	        continue;
+	    }
+	    for (uint8_t s = 0; s < stride; s++) {
+	        if (run == 0) {
+		        uint8_t n = pgm_read_byte(data++);
+		        repeat = (n >= 0x80);
+		        run = repeat ? n - 0x80 + 2 : n + 1;
+	        }
+	        run--;
+	        row[s] = pgm_read_byte(data);
+	        if (!repeat || run == 0) data++;
+	    }
+	    if (y >= clip.y1)
+	        blitRow<MODE>(bX, y, row, width);
+    }
+    return width;
+}
+
+/*--------------------------------------------------------------------------------------
+ Offset of a glyph's column data in the selected font, c counts from the font's first char
+--------------------------------------------------------------------------------------*/
+uint16_t DMDCanvas::glyphIndex(uint8_t c, uint8_t *width)
+{
+    uint8_t height = pgm_read_byte(this->Font + FONT_HEIGHT);
+    uint8_t bytes = (height + 7) / 8;
+    uint8_t charCount = pgm_read_byte(this->Font + FONT_CHAR_COUNT);
+    uint16_t index = 0;
+
+    if (pgm_read_byte(this->Font + FONT_LENGTH) == 0
+	    && pgm_read_byte(this->Font + FONT_LENGTH + 1) == 0) {
+	    // zero length is flag indicating fixed width font (array does not contain width data entries)
+	    *width = pgm_read_byte(this->Font + FONT_FIXED_WIDTH);
+	    index = c * bytes * *width + FONT_WIDTH_TABLE;
+    } else {
+	    // variable width font, read width data, to get the index
+	    for (uint8_t i = 0; i < c; i++) {
+	        index += pgm_read_byte(this->Font + FONT_WIDTH_TABLE + i);
+	    }
+	    index = index * bytes + charCount + FONT_WIDTH_TABLE;
+	    *width = pgm_read_byte(this->Font + FONT_WIDTH_TABLE + c);
+    }
+    return index;
+}
+
+//Mode specialised versions available to sketches
+#define INSTANTIATE_MODE(MODE) \
+    template void DMDCanvas::writePixel<MODE>(unsigned int bX, unsigned int bY, byte bPixel); \
+    template void DMDCanvas::drawLine<MODE>(int x1, int y1, int x2, int y2); \
+    template int DMDCanvas::drawChar<MODE>(const int bX, const int bY, const unsigned char letter);
+
+INSTANTIATE_MODE(GRAPHICS_NORMAL)
+INSTANTIATE_MODE(GRAPHICS_INVERSE)
+INSTANTIATE_MODE(GRAPHICS_TOGGLE)
+INSTANTIATE_MODE(GRAPHICS_OR)
+INSTANTIATE_MODE(GRAPHICS_NOR)
@@ -60,6 +60,11 @@ LED Panel Layout in RAM
 //Define this chip select pin that the Ethernet W5100 IC or other SPI device uses
 //if it is in use during a DMD scan request then scanDisplayBySPI() will exit without conflict! (and skip that scan)
 #define PIN_OTHER_SPI_nCS 10
+//SPI clock the pixels are clocked out at, 4MHz as SPI_CLOCK_DIV4 gives on a 16MHz board. A short cable
+//can take 8MHz. With an SPI library that has transactions the bus is switched to this only for the scan
+#ifndef DMD_SPI_CLOCK
+#define DMD_SPI_CLOCK     4000000
+#endif
 // ######################################################################################################################
 // ######################################################################################################################
 
@@ -71,6 +76,20 @@ LED Panel Layout in RAM
 #define LATCH_DMD_SHIFT_REG_TO_OUTPUT()   { digitalWrite( PIN_DMD_SCLK, HIGH ); digitalWrite( PIN_DMD_SCLK,  LOW ); }
 #define OE_DMD_ROWS_OFF()                 { digitalWrite( PIN_DMD_nOE, LOW  ); }
 #define OE_DMD_ROWS_ON()                  { digitalWrite( PIN_DMD_nOE, HIGH ); }
+//Rows on for part of the time, used by setPowerLimit(). OE_DMD_PWM_DUTY(duty) sets the share, duty/255,
+//for the rows the next scan lights, as the timer only takes a new compare value when its period ends, and
+//OE_DMD_ROWS_PWM() connects nOE to the PWM until OE_DMD_ROWS_OFF() disconnects it. Where pin 9 is OC1A
+//the duty is scaled to the TOP TimerOne (ICR1) or the Arduino core (0xFF) has given Timer1, leaving the
+//scan's timing alone. Other boards keep the rows fully on unless both are defined in the build flags
+#ifndef OE_DMD_ROWS_PWM
+#if PIN_DMD_nOE == 9 && (defined(__AVR_ATmega328P__) || defined(__AVR_ATmega168__) || defined(__AVR_ATmega32U4__))
+#define OE_DMD_PWM_DUTY(duty)             { OCR1A = (unsigned long)((TCCR1B & _BV(WGM13)) ? ICR1 : 0xFF) * (duty) / 255; }
+#define OE_DMD_ROWS_PWM()                 { TCCR1A |= _BV(COM1A1); }
+#else
+#define OE_DMD_PWM_DUTY(duty)             { }
+#define OE_DMD_ROWS_PWM()                 OE_DMD_ROWS_ON()
+#endif
+#endif
 
 //Pixel/graphics writing modes (bGraphicsMode)
 #define GRAPHICS_NORMAL    0
@@ -91,6 +110,20 @@ LED Panel Layout in RAM
 #define DMD_BITSPERPIXEL           1      //1 bit per pixel, use more bits to allow for pwm screen brightness control
 #define DMD_RAM_SIZE_BYTES        ((DMD_PIXELS_ACROSS*DMD_BITSPERPIXEL/8)*DMD_PIXELS_DOWN)
                                   // (32x * 1 / 8) = 4 bytes, * 16y = 64 bytes per screen here.
+
+//Index types sized for the display at compile time. The compact types keep AVR builds small and
+//fast and allow up to 255 panels, 64KB of DMD RAM and strings of 255 bytes. For bigger walls on
+//32 bit boards define DMD_WIDE_ADDRESSING in the build flags, it must be seen by DMD.cpp as well
+//as by the sketch
+#ifdef DMD_WIDE_ADDRESSING
+typedef uint16_t DMDPanelCount;      //panels across, down or in total
+typedef uint32_t DMDRamOffset;       //byte offset into DMD RAM
+typedef uint16_t DMDTextLength;      //length of a string in bytes
+#else
+typedef uint8_t DMDPanelCount;
+typedef uint16_t DMDRamOffset;
+typedef uint8_t DMDTextLength;
+#endif
 //lookup table for DMD::writePixel to make the pixel indexing routine faster
 static byte bPixelLookupTable[8] =
 {
@@ -104,6 +137,16 @@ static byte bPixelLookupTable[8] =
    0x01    //7, bit 0
 };
 
+//deepest nesting of pushClip and pushViewport, each level costs 12 bytes of RAM in every canvas
+#ifndef DMD_CLIP_STACK_DEPTH
+#define DMD_CLIP_STACK_DEPTH      4
+#endif
+
+//largest number of points drawFilledPolygon accepts, each costs about 28 bytes of stack while filling
+#ifndef DMD_MAX_POLYGON_POINTS
+#define DMD_MAX_POLYGON_POINTS    12
+#endif
+
 // Font Indices
 #define FONT_LENGTH             0
 #define FONT_FIXED_WIDTH        2
@@ -112,88 +155,444 @@ static byte bPixelLookupTable[8] =
 #define FONT_CHAR_COUNT         5
 #define FONT_WIDTH_TABLE        6
 
+// Row font indices, fonts compiled by extras/dmd_fontc.py. The magic is a FontCreator length no
+// AVR array can have and FONT_FIXED_WIDTH and FONT_HEIGHT keep their places, holding the widest
+// glyph and the font height
+#define FONT_ROW_MAGIC_0        0xFF
+#define FONT_ROW_MAGIC_1        0xD5
+#define FONT_ROW_GLYPH_ROWS     4
+#define FONT_ROW_RANGE_COUNT    5
+#define FONT_ROW_RANGES         6
+#define FONT_ROW_RANGE_BYTES    6       //first code point, count, first glyph number, 16 bits each
+#define FONT_ROW_GLYPH_RLE      0x01    //glyph flag, the rows are run length coded
+
+//Code point drawn in place of characters missing from the font, when the font has it
+#define DMD_REPLACEMENT_CHAR    0xFFFD
+
 typedef uint8_t (*FontCallback)(const uint8_t*);
 
+//Raster operation of a graphics mode on the pixels selected by mask in one byte of DMD RAM, on holds
+//a one bit for every lit source pixel. The mode is a template argument so the switch folds away
+template <byte MODE> struct DMDRasterOp
+{
+    static inline void apply(byte *ram, byte mask, byte on)
+    {
+        switch (MODE) {
+        case GRAPHICS_NORMAL:
+            *ram = (*ram & ~mask) | (mask & ~on);    // zero bit is pixel on
+            break;
+        case GRAPHICS_INVERSE:
+            *ram = (*ram & ~mask) | (mask & on);     // one bit is pixel off
+            break;
+        case GRAPHICS_TOGGLE:
+            *ram ^= (mask & on);
+            break;
+        case GRAPHICS_OR:
+            //only set pixels on
+            *ram &= ~(mask & on);
+            break;
+        case GRAPHICS_NOR:
+            //only clear on pixels
+            *ram |= (mask & on);
+            break;
+        }
+    }
+};
 
-//The main class of DMD library functions
-class DMD
+//Glyph cache slot header, followed in the cache by the glyph bitmap stored row by row in the
+//framebuffer's own bit order (MSB is the leftmost pixel), a one bit is a lit pixel
+struct DMDGlyphCacheSlot
+{
+    const uint8_t* font;    //font the cached glyph was rendered from, NULL for an empty slot
+    unsigned char letter;
+    uint8_t width;
+};
+
+//Clip rectangle in canvas pixels, inclusive, and the canvas position of drawing's 0,0
+struct DMDClipRect
+{
+    int x1, y1, x2, y2;
+    int originX, originY;
+};
+
+//Bytes of a row changed since dirty tracking was last cleared, first > last when there are none
+struct DMDDirtyRow
+{
+    uint16_t first, last;
+};
+
+//A monochrome bitmap with the whole drawing API, either the DMD itself or an off-screen canvas of any
+//size in a buffer the sketch provides. Rows are padded to whole bytes, pixels are laid out as in DMD RAM
+class DMDCanvas
 {
   public:
-    //Instantiate the DMD
-    DMD(byte panelsWide, byte panelsHigh);
-	//virtual ~DMD();
+    //Instantiate a canvas of width by height pixels drawing into buffer, which must hold bufferSize() bytes
+    DMDCanvas(byte* buffer, int width, int height);
+
+    //Bytes of buffer a canvas of width by height pixels needs
+    static DMDRamOffset bufferSize(int width, int height);
+
+  //Size of the whole display in pixels
+  int getWidth();
+  int getHeight();
+
+  //Offset into DMD RAM of the first byte of row y, each row's bytes are contiguous left to right
+  DMDRamOffset rowOffset(unsigned int bY)
+  {
+      return (bY / DMD_PIXELS_DOWN) * bandStride + (bY % DMD_PIXELS_DOWN) * rowStride;
+  }
+
+  //Clip all drawing to the width by height rectangle at x,y, inside any clip rectangle there is already.
+  //pushViewport also moves the origin to the rectangle's top left corner so a widget can draw from 0,0.
+  //Both return false and change nothing when DMD_CLIP_STACK_DEPTH are already pushed, only pop what was pushed
+  boolean pushClip(int x, int y, int width, int height);
+  boolean pushViewport(int x, int y, int width, int height);
+  void popClip();
+
+  //Drop every clip rectangle and the origin, drawing covers the whole canvas again
+  void resetClip();
+
+  //Record which bytes of each row drawing changes, at a cost of 4 bytes of RAM a row. Returns false if
+  //there is not enough RAM. Tracking starts with the whole canvas dirty, so the first export is complete,
+  //and so does drawing to another buffer or page, since exports read whichever one drawing goes to
+  boolean setDirtyTracking(boolean enable);
+
+  //Mark the pixels x1,y1 to x2,y2 changed, in canvas coordinates, for code writing DMD RAM directly
+  void markDirty(int x1, int y1, int x2, int y2);
+
+  //Whether anything has changed since clearDirty(), and the changed bytes of row y if it has any
+  boolean isDirty();
+  boolean getDirtySpan(int bY, int *firstByte, int *lastByte);
+
+  //Forget the changes made so far, once the consumer has taken them
+  void clearDirty();
+
+  //Write the changed bytes of the draw buffer to out as a DMDFrameDecoder patch frame, so a decoder
+  //mirroring the canvas ends up with the same pixels. Costs about as many bytes as changed, returns them.
+  //Frames carry a 16 bit length, so a canvas of more than 65535 bytes writes nothing and returns 0
+  size_t writeDirtyFrame(Print &out);
+
+  //Direct drawing to an off-screen buffer laid out like this canvas, or back to the canvas itself with NULL
+  void setDrawBuffer(byte* buffer);
+
+  //The buffer drawing currently goes to
+  byte* getDrawBuffer();
 
   //Set or clear a pixel at the x and y location (0,0 is the top left corner)
   void writePixel( unsigned int bX, unsigned int bY, byte bGraphicsMode, byte bPixel );
 
-  //Draw a string
-  void drawString( int bX, int bY, const char* bChars, byte length, byte bGraphicsMode);
+  //Whether the pixel at x,y of the draw buffer is lit, pixels off the canvas read as off
+  boolean readPixel( int bX, int bY );
+
+  //Write the draw buffer to out as a PBM image a row at a time, packed 1 bit per pixel (P4) or as
+  //plain text (P1), a one bit is a lit pixel. Returns the bytes written
+  size_t writePBM( Print &out, boolean plain = false );
+
+  //Versions of writePixel, drawLine and drawChar specialised for a GRAPHICS_* mode given as the template
+  //argument, e.g. dmd.drawLine<GRAPHICS_OR>(0, 0, 31, 15). The plain versions dispatch to these once per call
+  template <byte MODE> void writePixel( unsigned int bX, unsigned int bY, byte bPixel );
+  template <byte MODE> void drawLine( int x1, int y1, int x2, int y2 );
+  template <byte MODE> int drawChar( const int bX, const int bY, const unsigned char letter );
+
+  //Set or clear a pixel the caller has already clipped, at canvas x and y ignoring the origin, with no bounds check
+  template <byte MODE> void writePixelUnchecked( unsigned int bX, unsigned int bY, byte bPixel )
+  {
+      byte mask = bPixelLookupTable[bX & 0x07];
+      DMDRasterOp<MODE>::apply(bDMDScreenRAM + rowOffset(bY) + (bX >> 3), mask, bPixel ? mask : 0);
+      markDirtyBytes(bY, bX >> 3, bX >> 3);
+  }
+
+  //Draw a string of UTF-8 text, bytes that are not valid UTF-8 are drawn as Latin-1 characters
+  void drawString( int bX, int bY, const char* bChars, DMDTextLength length, byte bGraphicsMode);
 
-  //Select a text font
+  //Draw a string stored in flash (PROGMEM)
+  void drawString_P( int bX, int bY, const char* bChars, DMDTextLength length, byte bGraphicsMode);
+
+  //Select a text font, either a FontCreator font or a row font compiled by extras/dmd_fontc.py
   void selectFont(const uint8_t* font);
 
+  //The currently selected text font
+  const uint8_t* getFont();
+
   //Draw a single character
   int drawChar(const int bX, const int bY, const unsigned char letter, byte bGraphicsMode);
 
   //Find the width of a character
   int charWidth(const unsigned char letter);
 
-  //Draw a scrolling string
-  void drawMarquee( const char* bChars, byte length, int left, int top);
+  //Draw a single character by Unicode code point, characters missing from the font are drawn as a replacement
+  int drawGlyph(const int bX, const int bY, uint16_t code, byte bGraphicsMode);
 
-  //Move the maquee accross by amount
-  boolean stepMarquee( int amountX, int amountY);
+  //Find the width of a character by Unicode code point, as drawGlyph draws it
+  int glyphWidth(uint16_t code);
+
+  //Read the 8 pixels of a row of DMD RAM starting at any x, MSB first as in DMD RAM, pixels off either end
+  //of the row's rowBytes read as off
+  static byte readPixels(const byte *row, int x, int rowBytes)
+  {
+      int b = (x >= 0) ? x / 8 : -((7 - x) / 8);
+      byte shift = x - b * 8;
+      byte high = (b >= 0 && b < rowBytes) ? row[b] : 0xFF;
+      if (shift == 0) return high;
+      byte low = (b + 1 >= 0 && b + 1 < rowBytes) ? row[b + 1] : 0xFF;
+      return (high << shift) | (low >> (8 - shift));
+  }
+
+  //Decode the UTF-8 sequence at the start of count bytes, setting used to its length. Invalid bytes decode as Latin-1
+  static uint16_t decodeUTF8(const byte* bytes, byte count, byte* used);
+
+  //Reserve a RAM budget in bytes for caching recently drawn glyphs ready for byte blits, 0 disables the cache.
+  //Slots are sized for the first font drawn and resized, emptying the cache, for a glyph of a bigger one
+  void setGlyphCacheSize(unsigned int bytes);
+
+  //Glyph cache statistics
+  unsigned long getGlyphCacheHits();
+  unsigned long getGlyphCacheMisses();
+  void resetGlyphCacheStats();
 
   //Clear the screen in DMD RAM
   void clearScreen( byte bNormal );
 
+  //Shift rows y1 to y2 one pixel left across the whole display, clearing the rightmost column
+  void shiftRowsLeft( int y1, int y2 );
+
   //Draw or clear a line from x1,y1 to x2,y2
   void drawLine( int x1, int y1, int x2, int y2, byte bGraphicsMode );
 
   //Draw or clear a circle of radius r at x,y centre
   void drawCircle( int xCenter, int yCenter, int radius, byte bGraphicsMode );
 
+  //Draw or clear a filled circle of radius r at x,y centre
+  void drawFilledCircle( int xCenter, int yCenter, int radius, byte bGraphicsMode );
+
+  //Draw or clear an ellipse with x and y radii at x,y centre (xRadius * yRadius must be below 65536)
+  void drawEllipse( int xCenter, int yCenter, int xRadius, int yRadius, byte bGraphicsMode );
+
+  //Draw or clear a filled ellipse with x and y radii at x,y centre
+  void drawFilledEllipse( int xCenter, int yCenter, int xRadius, int yRadius, byte bGraphicsMode );
+
   //Draw or clear a box(rectangle) with a single pixel border
   void drawBox( int x1, int y1, int x2, int y2, byte bGraphicsMode );
 
   //Draw or clear a filled box(rectangle) with a single pixel border
   void drawFilledBox( int x1, int y1, int x2, int y2, byte bGraphicsMode );
 
+  //Draw or clear a box(rectangle) with corners rounded to radius
+  void drawRoundedBox( int x1, int y1, int x2, int y2, int radius, byte bGraphicsMode );
+
+  //Draw or clear a filled box(rectangle) with corners rounded to radius
+  void drawFilledRoundedBox( int x1, int y1, int x2, int y2, int radius, byte bGraphicsMode );
+
+  //Draw or clear a polygon outline through numPoints x,y pairs held in points
+  void drawPolygon( const int* points, byte numPoints, byte bGraphicsMode );
+
+  //Draw or clear a filled polygon through numPoints x,y pairs held in points, which may be concave
+  void drawFilledPolygon( const int* points, byte numPoints, byte bGraphicsMode );
+
+  //Draw or clear a triangle outline
+  void drawTriangle( int x1, int y1, int x2, int y2, int x3, int y3, byte bGraphicsMode );
+
+  //Draw or clear a filled triangle
+  void drawFilledTriangle( int x1, int y1, int x2, int y2, int x3, int y3, byte bGraphicsMode );
+
   //Draw the selected test pattern
   void drawTestPattern( byte bPattern );
 
+  //Copy a whole canvas, or the width by height region of it from srcX,srcY, with its top left corner
+  //at x,y. The lit pixels of the canvas are drawn in the graphics mode, a byte at a time
+  void drawCanvas( int bX, int bY, DMDCanvas &canvas, byte bGraphicsMode );
+  void drawCanvas( int bX, int bY, DMDCanvas &canvas, int srcX, int srcY, int width, int height, byte bGraphicsMode );
+
+  protected:
+    DMDCanvas();
+    void initCanvas( byte* buffer, int width, int height, DMDRamOffset bandStride, DMDRamOffset rowStride );
+
+    void writeSpan( int x1, int x2, int bY, byte bGraphicsMode );
+    template <byte MODE> void writeSpan( int x1, int x2, int bY );
+    void writeColumn( int bX, int y1, int y2, byte bGraphicsMode );
+    template <byte MODE> void writeColumn( int bX, int y1, int y2 );
+    void drawStringFrom( int bX, int bY, const char* bChars, DMDTextLength length, byte bGraphicsMode, boolean progmem );
+
+    //Note bytes first to last of row bY changed, when dirty tracking is on
+    void markDirtyBytes(int bY, int first, int last)
+    {
+        if (dirtyRows == NULL) return;
+        DMDDirtyRow &row = dirtyRows[bY];
+        if (first < row.first) row.first = first;
+        if (last > row.last) row.last = last;
+    }
+    void markDirtyRows(int y1, int y2, int first, int last);
+    size_t writePBMFrom( Print &out, const byte *ram, boolean plain );
+
+    //The canvas's own pixels, and where drawing goes, the canvas unless redirected by setDrawBuffer()
+    byte *bDMDCanvasRAM;
+    byte *bDMDScreenRAM;
+
+    //Pointer to current font, and whether it is a compiled row font
+    const uint8_t* Font;
+    boolean rowFont;
+
+    //Size in pixels, and the layout of rows: rowOffset() steps rowStride bytes a row and bandStride
+    //bytes every DMD_PIXELS_DOWN rows, so the DMD's interleaved panels and a plain bitmap share the code
+    int pixelsWide;
+    int pixelsHigh;
+    DMDRamOffset bytesWide;
+    DMDRamOffset bandStride;
+    DMDRamOffset rowStride;
+    DMDRamOffset bufferBytes;
+
+    //Clip rectangle and origin in use, and those pushClip() saved
+    DMDClipRect clip;
+    DMDClipRect clipStack[DMD_CLIP_STACK_DEPTH];
+    byte clipDepth;
+
+    //Changed bytes of each row, NULL when dirty tracking is off
+    DMDDirtyRow *dirtyRows;
+
+  private:
+    boolean pushClipRect(int x, int y, int width, int height, boolean viewport);
+
+    //Mask of the pixels of byte b of a row that are inside the clip rectangle, b must be inside it
+    byte clipMask(int b)
+    {
+        byte mask = 0xFF;
+        if (b == (clip.x1 >> 3)) mask &= 0xFF >> (clip.x1 & 0x07);
+        if (b == (clip.x2 >> 3)) mask &= 0xFF << (7 - (clip.x2 & 0x07));
+        return mask;
+    }
+
+    void drawRoundShape( int x1, int y1, int x2, int y2, int xRadius, int yRadius, boolean filled, byte bGraphicsMode );
+    void drawRoundedBoxShape( int x1, int y1, int x2, int y2, int radius, boolean filled, byte bGraphicsMode );
+    template <byte MODE> void blitCanvas( int bX, int bY, DMDCanvas &canvas, int srcX, int srcY, int width, int height );
+    boolean hasGlyph( uint16_t code );
+    uint16_t fontCodePoint( uint16_t code );
+    uint16_t glyphIndex( uint8_t c, uint8_t *width );
+    boolean layoutGlyphCache( uint8_t rows );
+    DMDGlyphCacheSlot *cachedGlyph( const unsigned char letter );
+    template <byte MODE> void blitGlyph( int bX, int bY, const byte *bitmap, uint8_t width, uint8_t rows );
+    template <byte MODE> void blitRow( int bX, int bY, const byte *bits, uint8_t width );
+    const uint8_t* rowFontGlyph( uint16_t code );
+    template <byte MODE> int drawRowFontChar( int bX, int bY, const uint8_t *glyph );
+
+    //Glyph cache values, slots are laid out on first use for the widest glyph of the font in use, and
+    //laid out again, emptying the cache, when a glyph of a wider or taller font does not fit them
+    byte *glyphCache;
+    unsigned int glyphCacheSize;
+    byte glyphCacheSlots;
+    byte glyphCacheSlotBytes;
+    unsigned long glyphCacheHits;
+    unsigned long glyphCacheMisses;
+};
+
+//The main class of DMD library functions
+class DMD : public DMDCanvas
+{
+  public:
+    //Instantiate the DMD
+    DMD(DMDPanelCount panelsWide, DMDPanelCount panelsHigh);
+	//virtual ~DMD();
+
+  //DMD RAM of the page drawing goes to and its size in bytes, for loading whole frames (see DMDFrameDecoder).
+  //With one page this is the display image. setPages() and drawToPage() can move it, fetch it again after them
+  byte* getScreenRAM();
+  DMDRamOffset getScreenRAMSize();
+
+  //DMD RAM of the page the scan is showing
+  byte* getShownPageRAM();
+
+  //Write the page being shown to out as a PBM image, the scan carries on while it is read
+  size_t writePBM( Print &out, boolean plain = false );
+
+  //Hold count pages of DMD RAM, page 0 being the one there is to start with. New pages start cleared.
+  //Returns false, keeping the pages there were, if there is not enough RAM. DMD RAM can move, so call it
+  //in setup() before taking getScreenRAM(), or point decoders and canvases over DMD RAM at it again after
+  boolean setPages(byte count);
+  byte getPageCount();
+
+  //Direct drawing to a page, the page shown can be a different one
+  void drawToPage(byte page);
+  byte getDrawPage();
+
+  //Show a page, the scan changes over when it next starts from the first row so a frame is never split
+  void showPage(byte page);
+
+  //Page the scan is showing, showPage() has taken effect once this returns the page asked for
+  byte getShownPage();
+
+  //Draw a scrolling string of UTF-8 text, the string is copied so the caller's buffer can be reused
+  void drawMarquee( const char* bChars, DMDTextLength length, int left, int top);
+
+  //Draw a scrolling string stored in flash (PROGMEM), read in place without a copy
+  void drawMarquee_P( const char* bChars, DMDTextLength length, int left, int top);
+
+  //Move the maquee accross by amount
+  boolean stepMarquee( int amountX, int amountY);
+
   //Scan the dot matrix LED panel display, from the RAM mirror out to the display hardware.
   //Call 4 times to scan the whole display which is made up of 4 interleaved rows within the 16 total rows.
   //Insert the calls to this function into the main loop for the highest call rate, or from a timer interrupt
   void scanDisplayBySPI();
 
+  //Hold the scan off the SPI bus while another driver or the sketch uses it, around code that does
+  //not take the PIN_OTHER_SPI_nCS route, e.g. an SD card write. Locks nest. A scan due while the bus
+  //is locked is run by the unlockSPI() that frees it, so the display keeps its timing. Shared by all
+  //DMDs. The alternative, SPI.usingInterrupt(255), holds all interrupts off during other transactions
+  static void lockSPI();
+  static void unlockSPI();
+
+  //Lit LEDs in scan row group 0 to 3 (panel rows 1, 5, 9, 13 are group 0 and so on) when it was last
+  //clocked out, or in all four groups. The scan counts them as it sends the pixels only while a power
+  //limit is set, otherwise they read 0. A limit of the display's pixel count counts without dimming
+  DMDRamOffset getLitPixels(byte group);
+  DMDRamOffset getLitPixels();
+
+  //Keep the average number of LEDs lit at once to maxLit by PWMing nOE, a row group with more lit is
+  //shown for maxLit / lit of the time (see OE_DMD_ROWS_PWM). 0 turns the limit and the counting off
+  void setPowerLimit(DMDRamOffset maxLit);
+  DMDRamOffset getPowerLimit();
 
   private:
-    void drawCircleSub( int cx, int cy, int x, int y, byte bGraphicsMode );
+    void startMarquee( DMDTextLength length, int left, int top );
+    uint16_t marqueeCodePoint( DMDTextLength *i );
 
     //Mirror of DMD pixels in RAM, ready to be clocked out by the main loop or high speed timer calls
-    byte *bDMDScreenRAM;
-
-    //Marquee values
-    char marqueeText[256];
-    byte marqueeLength;
+    byte *bDMDDisplayRAM;
+
+    //All pages of DMD RAM, page n starts n * getScreenRAMSize() bytes in
+    byte *bDMDPageRAM;
+    byte pageCount;
+    byte drawPage;
+    volatile byte shownPage;
+    volatile byte nextPage;
+
+    //Marquee values, the text is either in PROGMEM or in marqueeBuffer which grows to fit the longest RAM string
+    const char* marqueeText;
+    boolean marqueeProgmem;
+    char *marqueeBuffer;
+    unsigned int marqueeBufferSize;
+    DMDTextLength marqueeLength;
     int marqueeWidth;
     int marqueeHeight;
     int marqueeOffsetX;
     int marqueeOffsetY;
 
-    //Pointer to current font
-    const uint8_t* Font;
-
     //Display information
-    byte DisplaysWide;
-    byte DisplaysHigh;
-    byte DisplaysTotal;
-    int row1, row2, row3;
+    DMDPanelCount DisplaysWide;
+    DMDPanelCount DisplaysHigh;
+    DMDPanelCount DisplaysTotal;
+    DMDRamOffset row1, row2, row3;
 
-    //scanning pointer into bDMDScreenRAM, setup init @ 48 for the first valid scan
+    //scanning pointer into bDMDDisplayRAM, setup init @ 48 for the first valid scan
     volatile byte bDMDByte;
 
+    //Bus locks taken, and the display whose scan came due while the bus was locked
+    static volatile byte spiLocks;
+    static DMD * volatile deferredScan;
+
+    //Lit LEDs of each row group as last scanned, and the most allowed lit at once
+    volatile DMDRamOffset litPixels[4];
+    DMDRamOffset powerLimit;
+
 };
 
 #endif /* DMD_H_ */
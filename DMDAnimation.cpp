@@ -0,0 +1,130 @@
+/*--------------------------------------------------------------------------------------
+
+ DMDAnimation.cpp - Flash (PROGMEM) animation player for the Freetronics DMD library
+
+ Copyright (C) 2011 Marc Alexander (info <at> freetronics <dot> com)
+
+ ---
+
+ This program is free software: you can redistribute it and/or modify it under the terms
+ of the version 3 GNU General Public License as published by the Free Software Foundation.
+
+ This program is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ See the GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License along with this program.
+ If not, see <http://www.gnu.org/licenses/>.
+
+--------------------------------------------------------------------------------------*/
+#include "DMDAnimation.h"
+
+//Bytes before the first frame and before each frame's stream
+#define ANIMATION_HEADER_BYTES 4
+#define FRAME_HEADER_BYTES     2
+
+static unsigned int readWord(const uint8_t* p)
+{
+    return pgm_read_byte(p) | ((unsigned int)pgm_read_byte(p + 1) << 8);
+}
+
+DMDAnimation::DMDAnimation(DMD &dmd, const uint8_t* animation)
+  : decoder(dmd.getScreenRAM(), dmd.getScreenRAMSize())
+{
+    this->dmd = &dmd;
+    this->animation = animation;
+    frameCount = readWord(animation);
+    // animations made for another panel layout would decode into the wrong size, play nothing
+    if (readWord(animation + 2) != dmd.getScreenRAMSize())
+	    frameCount = 0;
+    frame = 0;
+    next = animation + ANIMATION_HEADER_BYTES;
+    playing = false;
+    looping = false;
+}
+
+/*--------------------------------------------------------------------------------------
+ Decode the frame at next into DMD RAM, leaving next at the frame after it
+--------------------------------------------------------------------------------------*/
+boolean DMDAnimation::showFrame()
+{
+    byte result;
+
+    duration = readWord(next);
+    next += FRAME_HEADER_BYTES;
+    // the draw page, which drawToPage() and setPages() can have moved since the last frame
+    decoder.setBuffer(dmd->getScreenRAM());
+    decoder.reset();
+    do {
+	    result = decoder.feed(pgm_read_byte(next++));
+    } while (result == DMD_FRAME_BUSY);
+    dmd->markDirty(0, 0, dmd->getWidth() - 1, dmd->getHeight() - 1);
+    return result == DMD_FRAME_COMPLETE;
+}
+
+void DMDAnimation::play(boolean loop)
+{
+    looping = loop;
+    playing = false;
+    if (frameCount == 0) return;
+    frame = 0;
+    next = animation + ANIMATION_HEADER_BYTES;
+    if (!showFrame()) return;
+    frameStart = millis();
+    playing = true;
+}
+
+void DMDAnimation::stop()
+{
+    playing = false;
+}
+
+boolean DMDAnimation::update()
+{
+    if (!playing) return false;
+    unsigned long now = millis();
+    if (now - frameStart < duration) return true;
+
+    if (frame + 1 >= frameCount) {
+	    if (!looping) {
+	        playing = false;
+	        return false;
+	    }
+	    frame = 0;
+	    next = animation + ANIMATION_HEADER_BYTES;
+    } else {
+	    frame++;
+    }
+
+    // keep to the animation's timing, unless we have fallen a whole frame behind
+    frameStart += duration;
+    if (!showFrame()) {
+	    playing = false;
+	    return false;
+    }
+    if (now - frameStart >= duration)
+	    frameStart = now;
+    return true;
+}
+
+boolean DMDAnimation::runTask()
+{
+    if (!playing || millis() - frameStart < duration) return false;
+    update();
+    return true;
+}
+
+boolean DMDAnimation::isPlaying()
+{
+    return playing;
+}
+
+unsigned int DMDAnimation::getFrame()
+{
+    return frame;
+}
+
+unsigned int DMDAnimation::getFrameCount()
+{
+    return frameCount;
+}
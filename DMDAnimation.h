@@ -0,0 +1,80 @@
+/*--------------------------------------------------------------------------------------
+
+ DMDAnimation.h - Flash (PROGMEM) animation player for the Freetronics DMD library
+
+ Copyright (C) 2011 Marc Alexander (info <at> freetronics <dot> com)
+
+ Plays a sequence of compressed frames stored in flash, decoding each one straight into
+ DMD RAM when its time comes, so animations far larger than RAM can be shown. update()
+ never blocks, call it as often as possible from the main loop.
+
+ Animation data is generated from PBM/PGM images by extras/dmd_anim.py:
+
+   frame count (2 bytes), frame size in bytes (2 bytes)
+   for each frame: duration in milliseconds (2 bytes), then the frame in the
+                   DMDFrameDecoder stream format (a keyframe or a delta)
+
+ All values are little endian. The first frame is always a keyframe, so playback can
+ start or loop from the beginning whatever is on the display.
+
+ ---
+
+ This program is free software: you can redistribute it and/or modify it under the terms
+ of the version 3 GNU General Public License as published by the Free Software Foundation.
+
+ This program is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ See the GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License along with this program.
+ If not, see <http://www.gnu.org/licenses/>.
+
+--------------------------------------------------------------------------------------*/
+#ifndef DMD_ANIMATION_H_
+#define DMD_ANIMATION_H_
+
+#include "DMD.h"
+#include "DMDScheduler.h"
+#include "DMDFrameDecoder.h"
+
+class DMDAnimation : public DMDTask
+{
+  public:
+    //Instantiate a player for an animation stored in flash (PROGMEM)
+    DMDAnimation(DMD &dmd, const uint8_t* animation);
+
+    //Show the first frame and start playing, looping back to the start if loop is true
+    void play(boolean loop = false);
+
+    //Stop on the current frame
+    void stop();
+
+    //Show the next frame once the current one's duration has passed. Returns true while playing
+    boolean update();
+
+    //Scheduler task, shows the next frame if one is due
+    boolean runTask();
+
+    boolean isPlaying();
+
+    //Frame now on the display and the number of frames in the animation
+    unsigned int getFrame();
+    unsigned int getFrameCount();
+
+  private:
+    boolean showFrame();
+
+    DMD *dmd;
+    const uint8_t* animation;
+    DMDFrameDecoder decoder;
+
+    unsigned int frameCount;
+    unsigned int frame;
+    const uint8_t* next;
+    unsigned int duration;
+    unsigned long frameStart;
+    boolean playing;
+    boolean looping;
+};
+
+#endif /* DMD_ANIMATION_H_ */
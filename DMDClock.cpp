@@ -0,0 +1,142 @@
+/*--------------------------------------------------------------------------------------
+
+ DMDClock.cpp - Clock and counter readout in fixed digit cells for the Freetronics DMD library
+
+ Copyright (C) 2011 Marc Alexander (info <at> freetronics <dot> com)
+
+ ---
+
+ This program is free software: you can redistribute it and/or modify it under the terms
+ of the version 3 GNU General Public License as published by the Free Software Foundation.
+
+ This program is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ See the GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License along with this program.
+ If not, see <http://www.gnu.org/licenses/>.
+
+--------------------------------------------------------------------------------------*/
+#include "DMDClock.h"
+
+/*--------------------------------------------------------------------------------------
+ Measure the font and render its cells into the strip. Only the strip is drawn here,
+ the display may not be set up yet when a clock is declared globally
+--------------------------------------------------------------------------------------*/
+DMDClock::DMDClock(DMDCanvas &dmd, int x, int y, const uint8_t* font, byte digits, byte colonAfter,
+		   byte spacing)
+{
+    this->dmd = &dmd;
+    this->x = x;
+    this->y = y;
+    this->digits = digits;
+    this->spacing = spacing;
+    height = pgm_read_byte(font + FONT_HEIGHT);
+    valid = false;
+
+    // a canvas with no pixels is enough to measure with
+    DMDCanvas cells(NULL, 0, 0);
+    cells.selectFont(font);
+    cellWidth = 0;
+    for (char c = '0'; c <= '9'; c++) {
+	    int width = cells.charWidth(c);
+	    if (width > cellWidth) cellWidth = width;
+    }
+    colonWidth = 0;
+    if (colonAfter > 0 && colonAfter < digits) {
+	    int width = cells.charWidth(':');
+	    if (width > 0) colonWidth = width;
+    }
+    this->colonAfter = (colonWidth > 0) ? colonAfter : 0;
+
+    shown = (byte *) malloc(digits);
+    strip = (byte *) malloc(DMDCanvas::bufferSize(stripWidth(), height));
+    if (strip == NULL) return;
+
+    DMDCanvas rendered(strip, stripWidth(), height);
+    rendered.clearScreen(true);
+    rendered.selectFont(font);
+    for (byte d = 0; d < 10; d++)
+	    rendered.drawChar(cellX(d) + (cellWidth - rendered.charWidth('0' + d)) / 2, 0, '0' + d, GRAPHICS_NORMAL);
+    if (this->colonAfter > 0)
+	    rendered.drawChar(cellX(DMD_CLOCK_COLON), 0, ':', GRAPHICS_NORMAL);
+}
+
+void DMDClock::invalidate()
+{
+    valid = false;
+}
+
+int DMDClock::getWidth()
+{
+    int width = digits * (cellWidth + spacing) - spacing;
+    if (colonAfter > 0) width += colonWidth + spacing;
+    return width;
+}
+
+int DMDClock::getHeight()
+{
+    return height;
+}
+
+//Left edge of a cell in the strip
+int DMDClock::cellX(byte cell)
+{
+    if (cell == DMD_CLOCK_BLANK) return 10 * cellWidth + colonWidth;
+    return cell * cellWidth;
+}
+
+//Width of the strip, the blank cell is last and also covers the colon's width
+int DMDClock::stripWidth()
+{
+    return cellX(DMD_CLOCK_BLANK) + ((colonWidth > cellWidth) ? colonWidth : cellWidth);
+}
+
+//Copy a cell of the strip to the display with its left edge at bX, a byte at a time
+void DMDClock::copyCell(int bX, byte cell, byte width)
+{
+    DMDCanvas cells(strip, stripWidth(), height);
+    dmd->drawCanvas(bX, y, cells, cellX(cell), 0, width, height, GRAPHICS_NORMAL);
+}
+
+//Clear the whole readout, including the spacing no cell covers, so every cell is known blank
+void DMDClock::clear()
+{
+    dmd->drawFilledBox(x, y, x + getWidth() - 1, y + height - 1, GRAPHICS_INVERSE);
+    for (byte i = 0; i < digits; i++)
+	    shown[i] = DMD_CLOCK_BLANK;
+    colonShown = DMD_CLOCK_BLANK;
+    valid = true;
+}
+
+/*--------------------------------------------------------------------------------------
+ Work from the units digit up, what is left of value once a digit's cell is reached is
+ the number showing from there left, so it is a leading zero exactly when that is zero
+--------------------------------------------------------------------------------------*/
+void DMDClock::update(unsigned long value, boolean leadingZeros)
+{
+    if (strip == NULL || shown == NULL) return;
+    if (!valid) clear();
+
+    for (byte i = digits; i-- > 0; ) {
+	    byte cell = value % 10;
+	    if (!leadingZeros && value == 0 && i < digits - 1) cell = DMD_CLOCK_BLANK;
+	    value /= 10;
+	    if (cell == shown[i]) continue;
+	    int bX = x + i * (cellWidth + spacing);
+	    if (colonAfter > 0 && i >= colonAfter) bX += colonWidth + spacing;
+	    copyCell(bX, cell, cellWidth);
+	    shown[i] = cell;
+    }
+}
+
+void DMDClock::setColon(boolean on)
+{
+    if (strip == NULL || shown == NULL || colonAfter == 0) return;
+    if (!valid) clear();
+
+    byte cell = on ? DMD_CLOCK_COLON : DMD_CLOCK_BLANK;
+    if (cell == colonShown) return;
+    copyCell(x + colonAfter * (cellWidth + spacing), cell, colonWidth);
+    colonShown = cell;
+}
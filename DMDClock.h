@@ -0,0 +1,85 @@
+/*--------------------------------------------------------------------------------------
+
+ DMDClock.h - Clock and counter readout in fixed digit cells for the Freetronics DMD library
+
+ Copyright (C) 2011 Marc Alexander (info <at> freetronics <dot> com)
+
+ The clock renders the digits 0 to 9 and the colon of its font once, into an off-screen
+ strip of cells as wide as the widest digit, followed by a blank cell. Each update then compares
+ the new digits against those on screen and copies only the cells that changed, and
+ showing or hiding the colon copies just its cell, so blinking the colon every second
+ costs a couple of bytes a row instead of clearing and redrawing the whole readout.
+
+ Digits narrower than the cell are centred in it, and cells are spacing pixels apart,
+ with the colon in its own cell after the colonAfter'th digit. The strip costs about
+ 12 cells' width / 8 * font height bytes of RAM, 208 for Arial_Black_16.
+
+ ---
+
+ This program is free software: you can redistribute it and/or modify it under the terms
+ of the version 3 GNU General Public License as published by the Free Software Foundation.
+
+ This program is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ See the GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License along with this program.
+ If not, see <http://www.gnu.org/licenses/>.
+
+--------------------------------------------------------------------------------------*/
+#ifndef DMD_CLOCK_H_
+#define DMD_CLOCK_H_
+
+#include "DMD.h"
+
+//Cells of the pre-rendered strip after the digits 0 to 9
+#define DMD_CLOCK_COLON       10
+#define DMD_CLOCK_BLANK       11
+
+class DMDClock
+{
+  public:
+    //Instantiate a readout of digits digit cells with its top left corner at x,y, the colon after the
+    //colonAfter'th digit (0 for no colon, as a plain counter) and cells spacing pixels apart
+    DMDClock(DMDCanvas &dmd, int x, int y, const uint8_t* font, byte digits = 4, byte colonAfter = 2,
+	     byte spacing = 1);
+
+    //Show the lowest digits of value, e.g. 1234 for 12:34, redrawing only the cells that changed.
+    //Without leadingZeros the zeros before the first significant digit are left blank
+    void update(unsigned long value, boolean leadingZeros = true);
+
+    //Show or hide the colon
+    void setColon(boolean on);
+
+    //Forget what is on screen so the next update and setColon redraw every cell
+    void invalidate();
+
+    //Width and height of the readout in pixels
+    int getWidth();
+    int getHeight();
+
+  private:
+    int cellX(byte cell);
+    int stripWidth();
+    void copyCell(int bX, byte cell, byte width);
+    void clear();
+
+    DMDCanvas *dmd;
+    int x, y;
+    byte digits;
+    byte colonAfter;
+    byte spacing;
+
+    //Pre-rendered cells: digits 0 to 9, the colon, then a blank as wide as the wider of a digit and the colon
+    byte *strip;
+    byte cellWidth;
+    byte colonWidth;
+    byte height;
+
+    //The cells currently on screen, only known once valid
+    byte *shown;
+    byte colonShown;
+    boolean valid;
+};
+
+#endif /* DMD_CLOCK_H_ */
@@ -0,0 +1,149 @@
+/*--------------------------------------------------------------------------------------
+
+ DMDFrameDecoder.cpp - Compressed frame stream decoder for the Freetronics DMD library
+
+ Copyright (C) 2011 Marc Alexander (info <at> freetronics <dot> com)
+
+ ---
+
+ This program is free software: you can redistribute it and/or modify it under the terms
+ of the version 3 GNU General Public License as published by the Free Software Foundation.
+
+ This program is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ See the GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License along with this program.
+ If not, see <http://www.gnu.org/licenses/>.
+
+--------------------------------------------------------------------------------------*/
+#include "DMDFrameDecoder.h"
+
+//Decoder states
+#define STATE_MAGIC       0
+#define STATE_TYPE        1
+#define STATE_LENGTH_LOW  2
+#define STATE_LENGTH_HIGH 3
+#define STATE_CONTROL     4
+#define STATE_LITERAL     5
+#define STATE_REPEAT      6
+
+DMDFrameDecoder::DMDFrameDecoder(byte* buffer, unsigned int size)
+{
+    this->buffer = buffer;
+    this->nextBuffer = buffer;
+    this->size = size;
+    frames = 0;
+    errors = 0;
+    reset();
+}
+
+void DMDFrameDecoder::setBuffer(byte* buffer)
+{
+    nextBuffer = buffer;
+    if (state == STATE_MAGIC)
+        this->buffer = buffer;
+}
+
+void DMDFrameDecoder::reset()
+{
+    state = STATE_MAGIC;
+    buffer = nextBuffer;
+}
+
+unsigned long DMDFrameDecoder::getFrames()
+{
+    return frames;
+}
+
+unsigned long DMDFrameDecoder::getErrors()
+{
+    return errors;
+}
+
+byte DMDFrameDecoder::fail()
+{
+    errors++;
+    reset();
+    return DMD_FRAME_ERROR;
+}
+
+/*--------------------------------------------------------------------------------------
+ Decode one byte of the stream, runs are written to the buffer as they are decoded
+--------------------------------------------------------------------------------------*/
+byte DMDFrameDecoder::feed(byte b)
+{
+    switch (state) {
+    case STATE_MAGIC:
+	    if (b == DMD_FRAME_MAGIC) state = STATE_TYPE;
+	    return DMD_FRAME_BUSY;
+    case STATE_TYPE:
+	    if (b == DMD_FRAME_MAGIC) return DMD_FRAME_BUSY;	// repeated marker, still waiting for the type
+	    if (b != DMD_FRAME_KEY && b != DMD_FRAME_DELTA && b != DMD_FRAME_PATCH) return fail();
+	    delta = (b == DMD_FRAME_DELTA);
+	    patch = (b == DMD_FRAME_PATCH);
+	    state = STATE_LENGTH_LOW;
+	    return DMD_FRAME_BUSY;
+    case STATE_LENGTH_LOW:
+	    length = b;
+	    state = STATE_LENGTH_HIGH;
+	    return DMD_FRAME_BUSY;
+    case STATE_LENGTH_HIGH:
+	    length |= (unsigned int)b << 8;
+	    if (length != size) return fail();	// never matches a size past 16 bits
+	    position = 0;
+	    state = STATE_CONTROL;
+	    return DMD_FRAME_BUSY;
+    case STATE_CONTROL:
+	    if (b < 0x80) {
+	        run = b + 1;
+	        state = STATE_LITERAL;
+	    } else {
+	        run = b - 0x80 + 2;
+	        state = STATE_REPEAT;
+	    }
+	    if (run > size - position) return fail();
+	    if (!patch || state == STATE_LITERAL) return DMD_FRAME_BUSY;
+	    position += run;	// bytes a patch leaves unchanged
+	    break;
+    case STATE_LITERAL:
+	    if (delta)
+		    buffer[position++] ^= b;
+	    else
+		    buffer[position++] = b;
+	    if (--run > 0) return DMD_FRAME_BUSY;
+	    break;
+    case STATE_REPEAT:
+	    if (delta) {
+	        if (b != 0) {
+		        for (; run > 0; run--)
+			        buffer[position++] ^= b;
+	        } else {
+		        position += run;	// unchanged bytes
+	        }
+	    } else {
+	        memset(buffer + position, b, run);
+	        position += run;
+	    }
+	    break;
+    }
+
+    // a run has finished
+    if (position < size) {
+	    state = STATE_CONTROL;
+	    return DMD_FRAME_BUSY;
+    }
+    frames++;
+    reset();
+    return DMD_FRAME_COMPLETE;
+}
+
+boolean DMDFrameDecoder::poll(Stream &stream)
+{
+    boolean complete = false;
+    while (stream.available() > 0) {
+	    if (feed(stream.read()) == DMD_FRAME_COMPLETE)
+		    complete = true;
+    }
+    return complete;
+}
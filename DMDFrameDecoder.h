@@ -0,0 +1,107 @@
+/*--------------------------------------------------------------------------------------
+
+ DMDFrameDecoder.h - Compressed frame stream decoder for the Freetronics DMD library
+
+ Copyright (C) 2011 Marc Alexander (info <at> freetronics <dot> com)
+
+ Decodes whole frames sent by a host straight into DMD RAM (or any buffer of the same
+ size, such as a back buffer) as the bytes arrive, with no staging copy of the frame.
+ Bytes can be pushed one at a time with feed() or pulled from any Stream with poll(),
+ so the decoder runs the same from Serial on the board or from a file or pipe on a PC.
+
+ Frames are in the framebuffer's own byte order (see extras/dmd_frames.py to encode
+ images for a given panel layout):
+
+   0xD3  type  length-low  length-high  payload...
+
+   type    'K' keyframe, the payload decodes to the new framebuffer contents
+           'D' delta, the payload decodes to bytes XORed into the framebuffer
+           'P' patch, as a keyframe but n >= 0x80 leaves n - 0x80 + 2 bytes unchanged
+               with no byte following, see DMDCanvas::writeDirtyFrame()
+   length  bytes of framebuffer the frame covers, must match the decoder's buffer, so frames
+           are limited to 64KB of DMD RAM even with DMD_WIDE_ADDRESSING
+   payload runs, each starting with a control byte n
+             n <  0x80  n + 1 literal bytes follow
+             n >= 0x80  the next byte is repeated n - 0x80 + 2 times
+
+ A delta of an unchanged area is a run of zero bytes, so only changes cost bandwidth.
+ Bytes that do not start a frame are skipped until the next 0xD3, which lets a
+ receiver joining mid stream or recovering from an error resync on its own.
+
+ ---
+
+ This program is free software: you can redistribute it and/or modify it under the terms
+ of the version 3 GNU General Public License as published by the Free Software Foundation.
+
+ This program is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ See the GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License along with this program.
+ If not, see <http://www.gnu.org/licenses/>.
+
+--------------------------------------------------------------------------------------*/
+#ifndef DMD_FRAME_DECODER_H_
+#define DMD_FRAME_DECODER_H_
+
+//Arduino toolchain header, version dependent
+#if defined(ARDUINO) && ARDUINO >= 100
+	#include "Arduino.h"
+#else
+	#include "WProgram.h"
+#endif
+
+//Frame stream markers
+#define DMD_FRAME_MAGIC       0xD3
+#define DMD_FRAME_KEY         'K'
+#define DMD_FRAME_DELTA       'D'
+#define DMD_FRAME_PATCH       'P'
+
+//feed() results
+#define DMD_FRAME_BUSY        0    //byte consumed, frame not finished yet
+#define DMD_FRAME_COMPLETE    1    //byte finished a frame
+#define DMD_FRAME_ERROR       2    //byte was not valid here, skipping to the next frame
+
+class DMDFrameDecoder
+{
+  public:
+    //Instantiate a decoder writing frames of size bytes into buffer, usually DMD::getScreenRAM().
+    //No frame can be longer than 65535 bytes, a decoder for a bigger buffer rejects every frame
+    DMDFrameDecoder(byte* buffer, unsigned int size);
+
+    //Point the decoder at another buffer of the same size, takes effect from the next frame
+    void setBuffer(byte* buffer);
+
+    //Decode one byte of the stream
+    byte feed(byte b);
+
+    //Decode every byte available from a stream, returns true if a frame was completed
+    boolean poll(Stream &stream);
+
+    //Abandon any partial frame and wait for the next one
+    void reset();
+
+    //Frame statistics
+    unsigned long getFrames();
+    unsigned long getErrors();
+
+  private:
+    byte fail();
+
+    byte* buffer;
+    byte* nextBuffer;
+    unsigned int size;
+
+    //Decoder state
+    byte state;
+    boolean delta;
+    boolean patch;
+    unsigned int length;
+    unsigned int position;
+    byte run;
+
+    unsigned long frames;
+    unsigned long errors;
+};
+
+#endif /* DMD_FRAME_DECODER_H_ */
@@ -0,0 +1,117 @@
+/*--------------------------------------------------------------------------------------
+
+ DMDScheduler.cpp - Cooperative frame scheduler for the Freetronics DMD library
+
+ Copyright (C) 2011 Marc Alexander (info <at> freetronics <dot> com)
+
+ ---
+
+ This program is free software: you can redistribute it and/or modify it under the terms
+ of the version 3 GNU General Public License as published by the Free Software Foundation.
+
+ This program is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ See the GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License along with this program.
+ If not, see <http://www.gnu.org/licenses/>.
+
+--------------------------------------------------------------------------------------*/
+#include "DMDScheduler.h"
+
+DMDScheduler::DMDScheduler(unsigned long budget)
+{
+    tasks = NULL;
+    resume = NULL;
+    taskCount = 0;
+    this->budget = budget;
+    resetStatistics();
+    tickTime = 0;
+}
+
+void DMDScheduler::add(DMDTask &task)
+{
+    DMDTask **link = &tasks;
+    while (*link) {
+	    if (*link == &task) return;
+	    link = &(*link)->nextTask;
+    }
+    task.nextTask = NULL;
+    *link = &task;
+    taskCount++;
+}
+
+void DMDScheduler::remove(DMDTask &task)
+{
+    for (DMDTask **link = &tasks; *link; link = &(*link)->nextTask) {
+	    if (*link == &task) {
+	        *link = task.nextTask;
+	        if (resume == &task) resume = task.nextTask;
+	        task.nextTask = NULL;
+	        taskCount--;
+	        return;
+	    }
+    }
+}
+
+/*--------------------------------------------------------------------------------------
+ Go round the tasks from where the last tick stopped, until a whole round of them finds
+ nothing due or the budget runs out
+--------------------------------------------------------------------------------------*/
+void DMDScheduler::tick()
+{
+    if (tasks == NULL) return;
+    unsigned long start = micros();
+    DMDTask *task = resume ? resume : tasks;
+    byte idle = 0;	// tasks in a row with nothing due
+
+    while (idle < taskCount) {
+	    if (task->runTask())
+	        idle = 0;
+	    else
+	        idle++;
+	    task = task->nextTask ? task->nextTask : tasks;
+	    if (micros() - start >= budget) {
+	        // the remaining tasks get the first go next time
+	        if (idle < taskCount) deferrals++;
+	        break;
+	    }
+    }
+    resume = task;
+
+    tickTime = micros() - start;
+    if (tickTime > maxTickTime) maxTickTime = tickTime;
+    if (tickTime > budget) overruns++;
+}
+
+void DMDScheduler::setBudget(unsigned long budget)
+{
+    this->budget = budget;
+}
+
+unsigned long DMDScheduler::getOverruns()
+{
+    return overruns;
+}
+
+unsigned long DMDScheduler::getDeferrals()
+{
+    return deferrals;
+}
+
+unsigned long DMDScheduler::getTickTime()
+{
+    return tickTime;
+}
+
+unsigned long DMDScheduler::getMaxTickTime()
+{
+    return maxTickTime;
+}
+
+void DMDScheduler::resetStatistics()
+{
+    overruns = 0;
+    deferrals = 0;
+    maxTickTime = 0;
+}
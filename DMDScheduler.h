@@ -0,0 +1,92 @@
+/*--------------------------------------------------------------------------------------
+
+ DMDScheduler.h - Cooperative frame scheduler for the Freetronics DMD library
+
+ Copyright (C) 2011 Marc Alexander (info <at> freetronics <dot> com)
+
+ Tickers, animations, transitions and any DMDTask of the sketch's own are registered with
+ a scheduler and all driven from one call to tick() in the main loop. Each call to a
+ task's runTask() does one chunk of work, such as a ticker step or an animation frame.
+ tick() keeps going round the tasks until none has work due or the time budget for the
+ frame is used up, and the next tick carries on from the task after the last one run, so
+ a busy task can not starve the others or hold up the rest of the main loop for long.
+
+   DMDScheduler scheduler(2000);         //2ms of drawing per pass of the main loop
+   scheduler.add(ticker);
+   scheduler.add(animation);
+   void loop() { scheduler.tick(); ...network handling... }
+
+ ---
+
+ This program is free software: you can redistribute it and/or modify it under the terms
+ of the version 3 GNU General Public License as published by the Free Software Foundation.
+
+ This program is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ See the GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License along with this program.
+ If not, see <http://www.gnu.org/licenses/>.
+
+--------------------------------------------------------------------------------------*/
+#ifndef DMD_SCHEDULER_H_
+#define DMD_SCHEDULER_H_
+
+#include "DMD.h"
+
+class DMDTask
+{
+  public:
+    DMDTask() : nextTask(NULL) {}
+
+    //Do one chunk of work if any is due, returns true if it did. Keep each chunk short,
+    //the scheduler only checks its budget between them
+    virtual boolean runTask() = 0;
+
+  private:
+    friend class DMDScheduler;
+    DMDTask *nextTask;
+};
+
+class DMDScheduler
+{
+  public:
+    //Instantiate a scheduler spending up to budget microseconds of each tick() on its tasks
+    DMDScheduler(unsigned long budget = 2000);
+
+    //Register a task, tasks are run in the order they were added. A task can be in one scheduler
+    void add(DMDTask &task);
+    void remove(DMDTask &task);
+
+    //Run due work until there is none left or the budget is used up, call once per pass of the main loop
+    void tick();
+
+    void setBudget(unsigned long budget);
+
+    //Ticks that ran past the budget, because a chunk of work was longer than the time left
+    unsigned long getOverruns();
+
+    //Ticks the budget ran out in before a round of the tasks found nothing due, the rest
+    //carried on in the next tick
+    unsigned long getDeferrals();
+
+    //Microseconds the last tick took and the longest any tick has taken
+    unsigned long getTickTime();
+    unsigned long getMaxTickTime();
+
+    //Zero the overrun and deferral counts and the longest tick time
+    void resetStatistics();
+
+  private:
+    DMDTask *tasks;
+    DMDTask *resume;
+    byte taskCount;
+
+    unsigned long budget;
+    unsigned long overruns;
+    unsigned long deferrals;
+    unsigned long tickTime;
+    unsigned long maxTickTime;
+};
+
+#endif /* DMD_SCHEDULER_H_ */
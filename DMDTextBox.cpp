@@ -0,0 +1,230 @@
+/*--------------------------------------------------------------------------------------
+
+ DMDTextBox.cpp - Word wrapped multi-line text for the Freetronics DMD library
+
+ Copyright (C) 2011 Marc Alexander (info <at> freetronics <dot> com)
+
+ ---
+
+ This program is free software: you can redistribute it and/or modify it under the terms
+ of the version 3 GNU General Public License as published by the Free Software Foundation.
+
+ This program is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ See the GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License along with this program.
+ If not, see <http://www.gnu.org/licenses/>.
+
+--------------------------------------------------------------------------------------*/
+#include "DMDTextBox.h"
+
+DMDTextBox::DMDTextBox(DMDCanvas &dmd, int x1, int y1, int x2, int y2, const uint8_t* font,
+		       byte maxLines)
+{
+    this->dmd = &dmd;
+    this->x1 = (x1 < x2) ? x1 : x2;
+    this->y1 = (y1 < y2) ? y1 : y2;
+    this->x2 = (x1 < x2) ? x2 : x1;
+    this->y2 = (y1 < y2) ? y2 : y1;
+    this->font = font;
+    this->maxLines = maxLines;
+    lines = (DMDTextLine *) malloc(maxLines * sizeof(DMDTextLine));
+    lineCount = 0;
+    alignment = ALIGN_LEFT;
+    spacing = 1;
+    text = NULL;
+    length = 0;
+    progmem = false;
+}
+
+void DMDTextBox::setAlignment(byte alignment)
+{
+    this->alignment = alignment;
+}
+
+void DMDTextBox::setLineSpacing(byte spacing)
+{
+    this->spacing = spacing;
+}
+
+byte DMDTextBox::layout(const char *bChars, unsigned int length)
+{
+    return layoutFrom(bChars, length, false);
+}
+
+byte DMDTextBox::layout_P(const char *bChars, unsigned int length)
+{
+    return layoutFrom(bChars, length, true);
+}
+
+//Decode the code point at text[*i], advancing *i past it
+uint16_t DMDTextBox::codePoint(unsigned int *i)
+{
+    byte bytes[4];
+    byte count = (length - *i < 4) ? length - *i : 4;
+    byte used;
+
+    for (byte k = 0; k < count; k++)
+	    bytes[k] = progmem ? pgm_read_byte(text + *i + k) : text[*i + k];
+    uint16_t code = DMD::decodeUTF8(bytes, count, &used);
+    *i += used;
+    return code;
+}
+
+//Add a line to the table, advance is its width plus the separator column after each glyph
+void DMDTextBox::endLine(unsigned int start, unsigned int end, int advance)
+{
+    if (lineCount >= maxLines) return;
+    lines[lineCount].start = start;
+    lines[lineCount].length = end - start;
+    lines[lineCount].width = (advance > 0) ? advance - 1 : 0;
+    lineCount++;
+}
+
+/*--------------------------------------------------------------------------------------
+ Break the text into lines in one pass. The last run of spaces on the line is remembered
+ along with the width of the line before it and of the glyphs since, so when a glyph
+ does not fit the line ends at the spaces and the next one starts with the word already
+ measured. A word wider than the box is broken before the glyph that does not fit.
+--------------------------------------------------------------------------------------*/
+byte DMDTextBox::layoutFrom(const char *bChars, unsigned int length, boolean progmem)
+{
+    text = bChars;
+    this->length = length;
+    this->progmem = progmem;
+    lineCount = 0;
+    if (lines == NULL) return 0;
+
+    const uint8_t* previousFont = dmd->getFont();
+    dmd->selectFont(font);
+
+    int boxWidth = x2 - x1 + 1;
+    int spaceAdvance = dmd->glyphWidth(' ') + 1;
+    unsigned int start = 0;		// first byte of the line being built
+    int advance = 0;			// width of the line so far
+    unsigned int breakEnd = 0;		// where the line ends if it breaks at the last run of spaces
+    int breakAdvance = -1;		// width of the line before that run, -1 if there is none
+    unsigned int resume = 0;		// first byte after the run
+    int tailAdvance = 0;		// width of the glyphs since the run
+    boolean space = false;		// the last glyph was a space
+
+    unsigned int i = 0;
+    while (i < length && lineCount < maxLines) {
+	    unsigned int at = i;
+	    uint16_t code = codePoint(&i);
+	    if (code == '\n') {
+	        // trailing spaces do not count towards the line's width
+	        if (space)
+		        endLine(start, breakEnd, breakAdvance);
+	        else
+		        endLine(start, at, advance);
+	        start = i;
+	        advance = 0;
+	        breakAdvance = -1;
+	        space = false;
+	        continue;
+	    }
+	    if (code < ' ') continue;
+	    if (code == ' ') {
+	        if (!space) {
+		        breakEnd = at;
+		        breakAdvance = advance;
+	        }
+	        advance += spaceAdvance;
+	        resume = i;
+	        tailAdvance = 0;
+	        space = true;
+	        continue;
+	    }
+	    space = false;
+	    int wide = dmd->glyphWidth(code);
+	    while (advance + wide > boxWidth && advance > 0 && lineCount < maxLines) {
+	        if (breakAdvance > 0) {
+		        endLine(start, breakEnd, breakAdvance);
+		        start = resume;
+		        advance = tailAdvance;
+	        } else {
+		        endLine(start, at, advance);
+		        start = at;
+		        advance = 0;
+	        }
+	        breakAdvance = -1;
+	    }
+	    advance += wide + 1;
+	    tailAdvance += wide + 1;
+    }
+    if (start < length) {
+	    if (space)
+	        endLine(start, breakEnd, breakAdvance);
+	    else
+	        endLine(start, length, advance);
+    }
+
+    dmd->selectFont(previousFont);
+    return lineCount;
+}
+
+/*--------------------------------------------------------------------------------------
+ Clear the box and draw each line of the layout that falls wholly inside it. The box is
+ already blank, so spaces and the separator columns between glyphs are just skipped.
+--------------------------------------------------------------------------------------*/
+void DMDTextBox::draw(int scroll, byte bGraphicsMode)
+{
+    const uint8_t* previousFont = dmd->getFont();
+    dmd->selectFont(font);
+
+    dmd->drawFilledBox(x1, y1, x2, y2, GRAPHICS_INVERSE);
+
+    // single byte high fonts also draw the blank row beneath the glyphs
+    uint8_t height = pgm_read_byte(font + FONT_HEIGHT);
+    int rows = (height < 8) ? height + 1 : height;
+    int spaceAdvance = dmd->glyphWidth(' ') + 1;
+
+    for (byte l = 0; l < lineCount; l++) {
+	    int y = y1 + l * getLineHeight() - scroll;
+	    if (y < y1) continue;
+	    if (y + rows - 1 > y2) break;
+
+	    int x = x1;
+	    if (alignment == ALIGN_CENTER)
+	        x += (x2 - x1 + 1 - lines[l].width) / 2;
+	    else if (alignment == ALIGN_RIGHT)
+	        x = x2 + 1 - lines[l].width;
+
+	    unsigned int i = lines[l].start;
+	    unsigned int end = lines[l].start + lines[l].length;
+	    while (i < end) {
+	        uint16_t code = codePoint(&i);
+	        if (code < ' ') continue;
+	        if (code == ' ') {
+		        x += spaceAdvance;
+		        continue;
+	        }
+	        int wide = dmd->drawGlyph(x, y, code, bGraphicsMode);
+	        if (wide > 0) x += wide + 1;
+	    }
+    }
+
+    dmd->selectFont(previousFont);
+}
+
+byte DMDTextBox::getLineCount()
+{
+    return lineCount;
+}
+
+const DMDTextLine* DMDTextBox::getLine(byte line)
+{
+    return (line < lineCount) ? &lines[line] : NULL;
+}
+
+int DMDTextBox::getLineHeight()
+{
+    return pgm_read_byte(font + FONT_HEIGHT) + spacing;
+}
+
+int DMDTextBox::getTextHeight()
+{
+    return (lineCount > 0) ? lineCount * getLineHeight() - spacing : 0;
+}
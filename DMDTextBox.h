@@ -0,0 +1,96 @@
+/*--------------------------------------------------------------------------------------
+
+ DMDTextBox.h - Word wrapped multi-line text for the Freetronics DMD library
+
+ Copyright (C) 2011 Marc Alexander (info <at> freetronics <dot> com)
+
+ A text box lays UTF-8 text out in a rectangle of the display, breaking lines at spaces
+ (or within a word too long for a line) and at newlines, and aligning each line left,
+ centred or right. Layout is one pass over the text measuring each glyph once, and the
+ resulting line table is kept so static text can be laid out once and redrawn, or
+ scrolled, without measuring it again. Only lines wholly inside the box are drawn.
+
+ The box keeps a pointer to the text it laid out rather than a copy, so the text must
+ stay unchanged until the next layout.
+
+ ---
+
+ This program is free software: you can redistribute it and/or modify it under the terms
+ of the version 3 GNU General Public License as published by the Free Software Foundation.
+
+ This program is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ See the GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License along with this program.
+ If not, see <http://www.gnu.org/licenses/>.
+
+--------------------------------------------------------------------------------------*/
+#ifndef DMD_TEXTBOX_H_
+#define DMD_TEXTBOX_H_
+
+#include "DMD.h"
+
+//Line alignments
+#define ALIGN_LEFT             0
+#define ALIGN_CENTER           1
+#define ALIGN_RIGHT            2
+
+//A laid out line, the bytes of text it shows and its width in pixels
+struct DMDTextLine
+{
+    unsigned int start;
+    unsigned int length;
+    int width;
+};
+
+class DMDTextBox
+{
+  public:
+    //Instantiate a text box filling x1,y1 to x2,y2 with room in its layout for up to maxLines lines
+    DMDTextBox(DMDCanvas &dmd, int x1, int y1, int x2, int y2, const uint8_t* font, byte maxLines);
+
+    //Line alignment and the blank pixel rows between lines, take effect from the next draw
+    void setAlignment(byte alignment);
+    void setLineSpacing(byte spacing);
+
+    //Lay out a string of UTF-8 text, returns the number of lines. Text past maxLines is dropped
+    byte layout(const char* bChars, unsigned int length);
+
+    //Lay out a string stored in flash (PROGMEM)
+    byte layout_P(const char* bChars, unsigned int length);
+
+    //Clear the box and draw the lines of the layout that fit, the first at scroll pixels above the top of the box
+    void draw(int scroll = 0, byte bGraphicsMode = GRAPHICS_NORMAL);
+
+    //The computed layout
+    byte getLineCount();
+    const DMDTextLine* getLine(byte line);
+
+    //Pixels from the top of one line to the top of the next, and the height of the whole layout
+    int getLineHeight();
+    int getTextHeight();
+
+  private:
+    byte layoutFrom(const char* bChars, unsigned int length, boolean progmem);
+    uint16_t codePoint(unsigned int *i);
+    void endLine(unsigned int start, unsigned int end, int advance);
+
+    DMDCanvas *dmd;
+    int x1, y1, x2, y2;
+    const uint8_t* font;
+    byte alignment;
+    byte spacing;
+
+    //Text of the current layout
+    const char* text;
+    unsigned int length;
+    boolean progmem;
+
+    //Line table
+    DMDTextLine *lines;
+    byte maxLines;
+    byte lineCount;
+};
+
+#endif /* DMD_TEXTBOX_H_ */
@@ -0,0 +1,109 @@
+/*--------------------------------------------------------------------------------------
+
+ DMDTextField.cpp - Incrementally updated text field for the Freetronics DMD library
+
+ Copyright (C) 2011 Marc Alexander (info <at> freetronics <dot> com)
+
+ ---
+
+ This program is free software: you can redistribute it and/or modify it under the terms
+ of the version 3 GNU General Public License as published by the Free Software Foundation.
+
+ This program is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ See the GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License along with this program.
+ If not, see <http://www.gnu.org/licenses/>.
+
+--------------------------------------------------------------------------------------*/
+#include "DMDTextField.h"
+
+DMDTextField::DMDTextField(DMDCanvas &dmd, int x, int y, const uint8_t* font, DMDTextLength maxLength,
+			   byte bGraphicsMode)
+{
+    this->dmd = &dmd;
+    this->x = x;
+    this->y = y;
+    this->font = font;
+    this->bGraphicsMode = bGraphicsMode;
+    this->maxLength = maxLength;
+    text = (char *) malloc(maxLength);
+    length = 0;
+    valid = false;
+}
+
+//Bytes decodeUTF8() may look at, a character is at most 4
+static inline byte utf8Count(DMDTextLength count)
+{
+    return (count > 4) ? 4 : count;
+}
+
+void DMDTextField::invalidate()
+{
+    valid = false;
+}
+
+/*--------------------------------------------------------------------------------------
+ Walk the old and new strings together, tracking where each character of both starts.
+ A character is redrawn when it differs from the old one in the same place or when an
+ earlier width change moved it, everything else is already correct on screen.
+--------------------------------------------------------------------------------------*/
+void DMDTextField::update(const char *bChars, DMDTextLength length)
+{
+    if (length > maxLength) length = maxLength;
+    if (text == NULL) return;
+
+    const uint8_t* previousFont = dmd->getFont();
+    dmd->selectFont(font);
+    uint8_t height = pgm_read_byte(font + FONT_HEIGHT);
+    boolean clearFirst = (bGraphicsMode == GRAPHICS_TOGGLE || bGraphicsMode == GRAPHICS_OR);
+
+    if (!valid) {
+        // nothing known about the screen, draw it all as drawString would
+        this->length = 0;
+        dmd->drawLine(x - 1, y, x - 1, y + height, GRAPHICS_INVERSE);
+    }
+
+    // walk both strings a UTF-8 character at a time, i and j index their bytes
+    int oldX = 0;
+    int newX = 0;
+    DMDTextLength i = 0;
+    DMDTextLength j = 0;
+    while (i < this->length || j < length) {
+        uint16_t oldCode = 0;
+        byte oldUsed = 0;
+        int oldWide = 0;
+        int newWide = 0;
+        if (i < this->length) {
+            oldCode = DMDCanvas::decodeUTF8((const byte *)text + i, utf8Count(this->length - i), &oldUsed);
+            oldWide = dmd->glyphWidth(oldCode);
+            i += oldUsed;
+        }
+        if (j < length) {
+            byte newUsed;
+            uint16_t newCode = DMDCanvas::decodeUTF8((const byte *)bChars + j, utf8Count(length - j), &newUsed);
+            newWide = dmd->glyphWidth(newCode);
+            if (oldUsed == 0 || oldCode != newCode || oldX != newX) {
+                // toggle and OR draw over what is there, so the old pixels of the cell go first
+                if (clearFirst && newWide > 0)
+                    dmd->drawFilledBox(x + newX, y, x + newX + newWide, y + height, GRAPHICS_INVERSE);
+                int charWide = dmd->drawGlyph(x + newX, y, newCode, bGraphicsMode);
+                if (charWide > 0)
+                    dmd->drawLine(x + newX + charWide, y, x + newX + charWide, y + height, GRAPHICS_INVERSE);
+            }
+            j += newUsed;
+        }
+        if (oldWide > 0) oldX += oldWide + 1;
+        if (newWide > 0) newX += newWide + 1;
+    }
+    memcpy(text, bChars, length);
+
+    // clear the columns only the old string covered
+    if (oldX > newX)
+        dmd->drawFilledBox(x + newX, y, x + oldX - 1, y + height, GRAPHICS_INVERSE);
+
+    this->length = length;
+    valid = true;
+    dmd->selectFont(previousFont);
+}
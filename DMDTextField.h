@@ -0,0 +1,61 @@
+/*--------------------------------------------------------------------------------------
+
+ DMDTextField.h - Incrementally updated text field for the Freetronics DMD library
+
+ Copyright (C) 2011 Marc Alexander (info <at> freetronics <dot> com)
+
+ A text field remembers the string, position and font it last rendered. Each update
+ compares the new string against it character by character and only redraws the
+ characters whose glyph or x position changed, then clears the columns the old string
+ used beyond the end of the new one. A clock readout where one digit changes per second
+ costs one glyph redraw rather than the whole string.
+
+ The field renders exactly as drawString() would over a cleared area, decoding UTF-8 the
+ same way and including the cleared single pixel separator columns between characters.
+ In GRAPHICS_TOGGLE and GRAPHICS_OR, which draw over what is there, the cell of each
+ character redrawn is cleared first.
+
+ ---
+
+ This program is free software: you can redistribute it and/or modify it under the terms
+ of the version 3 GNU General Public License as published by the Free Software Foundation.
+
+ This program is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ See the GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License along with this program.
+ If not, see <http://www.gnu.org/licenses/>.
+
+--------------------------------------------------------------------------------------*/
+#ifndef DMD_TEXTFIELD_H_
+#define DMD_TEXTFIELD_H_
+
+#include "DMD.h"
+
+class DMDTextField
+{
+  public:
+    //Instantiate a text field of up to maxLength bytes of text with its top left corner at x,y
+    DMDTextField(DMDCanvas &dmd, int x, int y, const uint8_t* font, DMDTextLength maxLength, byte bGraphicsMode = GRAPHICS_NORMAL);
+
+    //Render a string of UTF-8 text into the field, redrawing only what changed since the last update
+    void update(const char* bChars, DMDTextLength length);
+
+    //Forget the rendered string so the next update redraws the whole field
+    void invalidate();
+
+  private:
+    DMDCanvas *dmd;
+    int x, y;
+    const uint8_t* font;
+    byte bGraphicsMode;
+
+    //The string currently on screen
+    char *text;
+    DMDTextLength maxLength;
+    DMDTextLength length;
+    boolean valid;
+};
+
+#endif /* DMD_TEXTFIELD_H_ */
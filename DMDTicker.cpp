@@ -0,0 +1,154 @@
+/*--------------------------------------------------------------------------------------
+
+ DMDTicker.cpp - Continuously scrolling message ticker for the Freetronics DMD library
+
+ Copyright (C) 2011 Marc Alexander (info <at> freetronics <dot> com)
+
+ ---
+
+ This program is free software: you can redistribute it and/or modify it under the terms
+ of the version 3 GNU General Public License as published by the Free Software Foundation.
+
+ This program is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ See the GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License along with this program.
+ If not, see <http://www.gnu.org/licenses/>.
+
+--------------------------------------------------------------------------------------*/
+#include "DMDTicker.h"
+
+DMDTicker::DMDTicker(DMDCanvas &dmd, int top, const uint8_t* font, unsigned int capacity)
+{
+    this->dmd = &dmd;
+    this->top = top;
+    this->font = font;
+    queue = (byte *) malloc(capacity);
+    this->capacity = queue ? capacity : 0;
+    head = 0;
+    count = 0;
+    glyph = false;
+    width = 0;
+    column = 0;
+    gap = 8;
+    interval = 30;
+    lastStep = millis();
+}
+
+boolean DMDTicker::push(const char *bChars, DMDTextLength length)
+{
+    return push(bChars, length, false);
+}
+
+boolean DMDTicker::push_P(const char *bChars, DMDTextLength length)
+{
+    return push(bChars, length, true);
+}
+
+boolean DMDTicker::push(const char *bChars, DMDTextLength length, boolean progmem)
+{
+    // the message and its terminating zero must fit
+    if (count + length + 1 > capacity) return false;
+    unsigned int tail = head + count;
+    for (DMDTextLength i = 0; i < length; i++, tail++) {
+        if (tail >= capacity) tail -= capacity;
+        queue[tail] = progmem ? pgm_read_byte(bChars + i) : bChars[i];
+    }
+    if (tail >= capacity) tail -= capacity;
+    queue[tail] = '\0';
+    count += length + 1;
+    return true;
+}
+
+void DMDTicker::setInterval(unsigned int interval)
+{
+    this->interval = interval;
+}
+
+void DMDTicker::setGap(byte gap)
+{
+    this->gap = gap;
+}
+
+unsigned int DMDTicker::available()
+{
+    return capacity - count;
+}
+
+boolean DMDTicker::isEmpty()
+{
+    return count == 0 && column >= width;
+}
+
+/*--------------------------------------------------------------------------------------
+ Take the next glyph from the queue, a message separator becomes a blank gap and an
+ empty queue scrolls single blank columns until something is pushed
+--------------------------------------------------------------------------------------*/
+void DMDTicker::nextGlyph()
+{
+    column = 0;
+    glyph = false;
+    width = 0;
+    while (width == 0) {
+        if (count == 0) {
+            width = 1;
+            return;
+        }
+        // decode a UTF-8 sequence, which may wrap around the end of the queue
+        byte bytes[4];
+        byte used;
+        byte n = (count < 4) ? count : 4;
+        unsigned int at = head;
+        for (byte k = 0; k < n; k++) {
+            bytes[k] = queue[at];
+            if (++at >= capacity) at = 0;
+        }
+        letter = DMD::decodeUTF8(bytes, n, &used);
+        head += used;
+        if (head >= capacity) head -= capacity;
+        count -= used;
+        if (letter == '\0') {
+            width = gap;
+        } else {
+            width = dmd->glyphWidth(letter);
+            if (width > 0) {
+                // glyph columns plus the blank separator column after it
+                glyph = true;
+                width++;
+            }
+        }
+    }
+}
+
+/*--------------------------------------------------------------------------------------
+ Shift the band one pixel left and draw the entering glyph at the right edge, the
+ separator and gap columns are already blank from the shift
+--------------------------------------------------------------------------------------*/
+void DMDTicker::step()
+{
+    const uint8_t* previousFont = dmd->getFont();
+    dmd->selectFont(font);
+
+    int right = dmd->getWidth() - 1;
+    dmd->shiftRowsLeft(top, top + pgm_read_byte(font + FONT_HEIGHT) - 1);
+    if (column >= width) nextGlyph();
+    if (glyph && column < width - 1)
+        dmd->drawGlyph(right - column, top, letter, GRAPHICS_NORMAL);
+    column++;
+
+    dmd->selectFont(previousFont);
+}
+
+boolean DMDTicker::update()
+{
+    if (millis() - lastStep < interval) return false;
+    lastStep = millis();
+    step();
+    return true;
+}
+
+boolean DMDTicker::runTask()
+{
+    return update();
+}
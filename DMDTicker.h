@@ -0,0 +1,93 @@
+/*--------------------------------------------------------------------------------------
+
+ DMDTicker.h - Continuously scrolling message ticker for the Freetronics DMD library
+
+ Copyright (C) 2011 Marc Alexander (info <at> freetronics <dot> com)
+
+ A ticker scrolls a band of the display to the left, pulling its text from a ring buffer
+ queue of messages. New messages can be pushed at any time while the current one is
+ scrolling, they follow on after a gap without restarting the scroll.
+
+ Glyphs are only rendered as they enter from the right edge and their text is dropped
+ from the queue as soon as they have, so the ticker holds no more than the queued text
+ and one glyph in flight however long the stream of messages gets.
+
+ ---
+
+ This program is free software: you can redistribute it and/or modify it under the terms
+ of the version 3 GNU General Public License as published by the Free Software Foundation.
+
+ This program is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ See the GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License along with this program.
+ If not, see <http://www.gnu.org/licenses/>.
+
+--------------------------------------------------------------------------------------*/
+#ifndef DMD_TICKER_H_
+#define DMD_TICKER_H_
+
+#include "DMD.h"
+#include "DMDScheduler.h"
+
+class DMDTicker : public DMDTask
+{
+  public:
+    //Instantiate a ticker scrolling the rows from top down for the font height, queueing up to capacity bytes of text
+    DMDTicker(DMDCanvas &dmd, int top, const uint8_t* font, unsigned int capacity);
+
+    //Append a message of UTF-8 text to the queue, returns false if there is not room for all of it
+    boolean push(const char* bChars, DMDTextLength length);
+
+    //Append a message stored in flash (PROGMEM) to the queue
+    boolean push_P(const char* bChars, DMDTextLength length);
+
+    //Scroll the ticker one pixel left, drawing the next column of the entering glyph
+    void step();
+
+    //Step the ticker once its interval has passed, call as often as possible from the main loop.
+    //Returns true if it stepped
+    boolean update();
+
+    //Scheduler task, steps the ticker if its interval has passed
+    boolean runTask();
+
+    //Milliseconds between steps of update()
+    void setInterval(unsigned int interval);
+
+    //Blank pixels scrolled between messages
+    void setGap(byte gap);
+
+    //Bytes of the queue free for new messages
+    unsigned int available();
+
+    //True once the queue is empty and the last glyph has fully entered
+    boolean isEmpty();
+
+  private:
+    boolean push(const char* bChars, DMDTextLength length, boolean progmem);
+    void nextGlyph();
+
+    DMDCanvas *dmd;
+    int top;
+    const uint8_t* font;
+
+    //Message queue, messages are separated by a zero byte
+    byte *queue;
+    unsigned int capacity;
+    unsigned int head;
+    unsigned int count;
+
+    //Glyph entering from the right edge
+    uint16_t letter;
+    boolean glyph;
+    int width;
+    int column;
+
+    byte gap;
+    unsigned int interval;
+    unsigned long lastStep;
+};
+
+#endif /* DMD_TICKER_H_ */
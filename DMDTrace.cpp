@@ -0,0 +1,129 @@
+/*--------------------------------------------------------------------------------------
+
+ DMDTrace.cpp - Trace points for timing the Freetronics DMD library on the board
+
+ Copyright (C) 2011 Marc Alexander (info <at> freetronics <dot> com)
+
+ ---
+
+ This program is free software: you can redistribute it and/or modify it under the terms
+ of the version 3 GNU General Public License as published by the Free Software Foundation.
+
+ This program is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ See the GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License along with this program.
+ If not, see <http://www.gnu.org/licenses/>.
+
+--------------------------------------------------------------------------------------*/
+#include "DMDTrace.h"
+
+#ifdef DMD_TRACE
+
+//Names of the library's call ids, in id order
+static const char traceNames[] PROGMEM =
+    "scanDisplayBySPI\0clearScreen\0writePixel\0drawString\0drawChar\0drawGlyph\0"
+    "drawMarquee\0stepMarquee\0shiftRowsLeft\0drawLine\0drawRound\0drawBox\0"
+    "drawPolygon\0drawTestPattern\0drawCanvas\0writePBM\0writeDirtyFrame";
+
+DMDTraceEvent DMDTrace::events[DMD_TRACE_DEPTH];
+volatile unsigned int DMDTrace::head = 0;
+volatile unsigned int DMDTrace::count = 0;
+volatile unsigned long DMDTrace::lost = 0;
+volatile boolean DMDTrace::paused = false;
+
+/*--------------------------------------------------------------------------------------
+ Record an event, the scan records from its timer interrupt so the buffer is only
+ touched with interrupts held off, restoring rather than enabling them on AVR in case
+ this is the interrupt
+--------------------------------------------------------------------------------------*/
+void DMDTrace::record(byte id)
+{
+#if defined(__AVR__)
+    byte sreg = SREG;
+    cli();
+#else
+    noInterrupts();
+#endif
+    if (!paused) {
+	    events[head].time = micros();
+	    events[head].id = id;
+	    if (++head >= DMD_TRACE_DEPTH) head = 0;
+	    if (count < DMD_TRACE_DEPTH)
+		    count++;
+	    else
+		    lost++;
+    }
+#if defined(__AVR__)
+    SREG = sreg;
+#else
+    interrupts();
+#endif
+}
+
+static void printName(Print &out, byte id)
+{
+    if (id >= DMD_TRACE_APP) {
+	    out.print("app ");
+	    out.print((unsigned int)id);
+	    return;
+    }
+    if (id >= DMD_TRACE_LIBRARY_IDS) {
+	    out.print("id ");
+	    out.print((unsigned int)id);
+	    return;
+    }
+    const char *name = traceNames;
+    for (; id > 0; id--)
+	    while (pgm_read_byte(name++) != '\0') ;
+    for (char c; (c = pgm_read_byte(name)) != '\0'; name++)
+	    out.print(c);
+}
+
+/*--------------------------------------------------------------------------------------
+ Print the buffer as lines of time, > for a call starting or < for it finishing, and
+ the call's name, between a header giving the events lost to overwriting and an end
+ line. extras/dmd_trace.py reads this from a capture of the serial output
+--------------------------------------------------------------------------------------*/
+void DMDTrace::dump(Print &out)
+{
+    noInterrupts();
+    paused = true;
+    unsigned int n = count;
+    unsigned int first = (head + DMD_TRACE_DEPTH - n) % DMD_TRACE_DEPTH;
+    unsigned long dropped = lost;
+    interrupts();
+
+    out.print("DMD trace ");
+    out.print(n);
+    out.print(" events ");
+    out.print(dropped);
+    out.println(" lost");
+    for (unsigned int i = 0; i < n; i++) {
+	    const DMDTraceEvent &event = events[(first + i) % DMD_TRACE_DEPTH];
+	    out.print(event.time);
+	    out.print((event.id & DMD_TRACE_EXIT) ? " < " : " > ");
+	    printName(out, event.id & ~DMD_TRACE_EXIT);
+	    out.println();
+    }
+    out.println("DMD trace end");
+
+    noInterrupts();
+    head = 0;
+    count = 0;
+    lost = 0;
+    paused = false;
+    interrupts();
+}
+
+void DMDTrace::clear()
+{
+    noInterrupts();
+    head = 0;
+    count = 0;
+    lost = 0;
+    interrupts();
+}
+
+#endif /* DMD_TRACE */
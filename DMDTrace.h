@@ -0,0 +1,127 @@
+/*--------------------------------------------------------------------------------------
+
+ DMDTrace.h - Trace points for timing the Freetronics DMD library on the board
+
+ Copyright (C) 2011 Marc Alexander (info <at> freetronics <dot> com)
+
+ With DMD_TRACE defined in the build flags (it must reach the library as well as the
+ sketch) the public drawing methods and the scan record a timestamp in microseconds and
+ their call id into a ring buffer as they start and finish. The sketch can add its own
+ trace points with ids from DMD_TRACE_APP up, and dumps the buffer to Serial when it
+ wants a look:
+
+   void loop() {
+     DMD_TRACE_SCOPE(DMD_TRACE_APP);    //times the rest of this block as "app 64"
+     ...
+     if (Serial.read() == 't') DMDTrace::dump(Serial);
+   }
+
+ extras/dmd_trace.py turns a dump into per-function call counts and total and self times,
+ and a timeline. Without DMD_TRACE the trace points compile to nothing at all.
+
+ Sketches plotting pixel by pixel would fill the buffer with writePixel calls in no time,
+ so it is only traced with DMD_TRACE_PIXELS defined as well.
+
+ ---
+
+ This program is free software: you can redistribute it and/or modify it under the terms
+ of the version 3 GNU General Public License as published by the Free Software Foundation.
+
+ This program is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ See the GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License along with this program.
+ If not, see <http://www.gnu.org/licenses/>.
+
+--------------------------------------------------------------------------------------*/
+#ifndef DMD_TRACE_H_
+#define DMD_TRACE_H_
+
+//Arduino toolchain header, version dependent
+#if defined(ARDUINO) && ARDUINO >= 100
+	#include "Arduino.h"
+#else
+	#include "WProgram.h"
+#endif
+
+//Events the ring buffer holds, older ones are overwritten. Each takes 5 bytes of RAM
+#ifndef DMD_TRACE_DEPTH
+#define DMD_TRACE_DEPTH           64
+#endif
+
+//Call ids of the library's trace points, in the order of the names dump() prints
+#define DMD_TRACE_SCAN            0
+#define DMD_TRACE_CLEAR_SCREEN    1
+#define DMD_TRACE_WRITE_PIXEL     2     //only with DMD_TRACE_PIXELS
+#define DMD_TRACE_DRAW_STRING     3
+#define DMD_TRACE_DRAW_CHAR       4
+#define DMD_TRACE_DRAW_GLYPH      5
+#define DMD_TRACE_DRAW_MARQUEE    6
+#define DMD_TRACE_STEP_MARQUEE    7
+#define DMD_TRACE_SHIFT_ROWS      8
+#define DMD_TRACE_DRAW_LINE       9
+#define DMD_TRACE_DRAW_ROUND      10    //circles and ellipses
+#define DMD_TRACE_DRAW_BOX        11    //boxes, including rounded ones
+#define DMD_TRACE_DRAW_POLYGON    12    //polygons and triangles
+#define DMD_TRACE_TEST_PATTERN    13
+#define DMD_TRACE_DRAW_CANVAS     14
+#define DMD_TRACE_WRITE_PBM       15
+#define DMD_TRACE_DIRTY_FRAME     16
+#define DMD_TRACE_LIBRARY_IDS     17
+
+//First id for the sketch's own trace points, up to 127
+#define DMD_TRACE_APP             64
+
+//Set in the id of the event recorded when a call finishes
+#define DMD_TRACE_EXIT            0x80
+
+#ifdef DMD_TRACE
+
+struct DMDTraceEvent
+{
+    unsigned long time;
+    byte id;
+};
+
+class DMDTrace
+{
+  public:
+    //Record the start of call id, or its end with DMD_TRACE_EXIT set. Safe from interrupts
+    static void record(byte id);
+
+    //Print the events recorded so far, oldest first, one per line, and empty the buffer.
+    //Recording pauses while it prints
+    static void dump(Print &out);
+
+    //Forget the events recorded so far
+    static void clear();
+
+  private:
+    static DMDTraceEvent events[DMD_TRACE_DEPTH];
+    static volatile unsigned int head;
+    static volatile unsigned int count;
+    static volatile unsigned long lost;
+    static volatile boolean paused;
+};
+
+//Records the start of call id and, when it goes out of scope, the end
+class DMDTraceScope
+{
+  public:
+    DMDTraceScope(byte id) : id(id) { DMDTrace::record(id); }
+    ~DMDTraceScope() { DMDTrace::record(id | DMD_TRACE_EXIT); }
+
+  private:
+    byte id;
+};
+
+#define DMD_TRACE_SCOPE(id)       DMDTraceScope dmdTraceScope(id)
+
+#else
+
+#define DMD_TRACE_SCOPE(id)
+
+#endif /* DMD_TRACE */
+
+#endif /* DMD_TRACE_H_ */
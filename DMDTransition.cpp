@@ -0,0 +1,259 @@
+/*--------------------------------------------------------------------------------------
+
+ DMDTransition.cpp - Screen transition effects for the Freetronics DMD library
+
+ Copyright (C) 2011 Marc Alexander (info <at> freetronics <dot> com)
+
+ ---
+
+ This program is free software: you can redistribute it and/or modify it under the terms
+ of the version 3 GNU General Public License as published by the Free Software Foundation.
+
+ This program is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ See the GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License along with this program.
+ If not, see <http://www.gnu.org/licenses/>.
+
+--------------------------------------------------------------------------------------*/
+#include "DMDTransition.h"
+
+//Galois LFSR taps giving a maximal length sequence for 10 to 17 bits, enough to order the
+//pixels of one panel up to the 255 panels a DMD can drive, and with DMD_WIDE_ADDRESSING up to
+//32 bits for the larger displays it allows
+#define LFSR_MIN_BITS 10
+#ifdef DMD_WIDE_ADDRESSING
+#define LFSR_MAX_BITS 32
+#else
+#define LFSR_MAX_BITS 17
+#endif
+static const uint32_t lfsrTaps[] PROGMEM = {
+    0x240, 0x500, 0x829, 0x100D, 0x2015, 0x6000, 0xD008, 0x12000
+#ifdef DMD_WIDE_ADDRESSING
+    , 0x20400, 0x40023, 0x90000, 0x140000, 0x300000, 0x420000, 0xE10000, 0x1200000,
+    0x2000023, 0x4000013, 0x9000000, 0x14000000, 0x20000029, 0x48000000, 0x80200003
+#endif
+};
+
+DMDTransition::DMDTransition(DMD &dmd)
+{
+    this->dmd = &dmd;
+    target = (byte *) malloc(dmd.getScreenRAMSize());
+    width = dmd.getWidth();
+    height = dmd.getHeight();
+    rowBytes = width / 8;
+    running = false;
+    interval = 30;
+    lastStep = millis();
+}
+
+void DMDTransition::beginFrame()
+{
+    if (target == NULL) return;
+    dmd->setDrawBuffer(target);
+    dmd->clearScreen(true);
+}
+
+void DMDTransition::start(byte effect, unsigned int steps)
+{
+    dmd->setDrawBuffer(NULL);
+    if (target == NULL) return;
+    this->effect = effect;
+    this->steps = steps;
+    stepCount = 0;
+    edge = 0;
+    running = true;
+    lastStep = millis();
+
+    if (effect == TRANSITION_DISSOLVE) {
+        // the smallest LFSR whose sequence covers every pixel
+        pixels = (unsigned long)dmd->getScreenRAMSize() * 8;
+        byte bits = LFSR_MIN_BITS;
+        while (bits < LFSR_MAX_BITS && (1UL << bits) <= pixels) bits++;
+        taps = pgm_read_dword(&lfsrTaps[bits - LFSR_MIN_BITS]);
+        lfsr = 1;
+    }
+    if (steps == 0) finish();
+}
+
+void DMDTransition::finish()
+{
+    if (target != NULL) {
+        memcpy(dmd->getScreenRAM(), target, dmd->getScreenRAMSize());
+        dmd->markDirty(0, 0, width - 1, height - 1);
+    }
+    running = false;
+}
+
+boolean DMDTransition::isRunning()
+{
+    return running;
+}
+
+void DMDTransition::setInterval(unsigned int interval)
+{
+    this->interval = interval;
+}
+
+boolean DMDTransition::update()
+{
+    if (!running) return false;
+    if (millis() - lastStep < interval) return true;
+    lastStep = millis();
+    step();
+    return running;
+}
+
+boolean DMDTransition::runTask()
+{
+    if (!running || millis() - lastStep < interval) return false;
+    update();
+    return true;
+}
+
+/*--------------------------------------------------------------------------------------
+ Move the edge between the screens to its place for the next step. Wipes copy only the
+ pixels the edge passed over, slides redraw the part of the new screen that is showing
+ and pushes first shift the old screen along by the distance the edge moved
+--------------------------------------------------------------------------------------*/
+void DMDTransition::step()
+{
+    if (!running) return;
+    if (++stepCount >= steps) {
+        finish();
+        return;
+    }
+
+    if (effect == TRANSITION_DISSOLVE) {
+        dissolve(pixels * stepCount / steps - pixels * (stepCount - 1) / steps);
+        return;
+    }
+
+    boolean across = (effect & 0x03) < 2;
+    int extent = across ? width : height;
+    int next = (long)extent * stepCount / steps;
+    int moved = next - edge;
+    byte *display = dmd->getScreenRAM();
+
+    switch (effect) {
+    case TRANSITION_WIPE_LEFT:
+        copyColumns(width - next, moved, width - next, target);
+        break;
+    case TRANSITION_WIPE_RIGHT:
+        copyColumns(edge, moved, edge, target);
+        break;
+    case TRANSITION_WIPE_UP:
+        copyRows(height - next, moved, height - next, target);
+        break;
+    case TRANSITION_WIPE_DOWN:
+        copyRows(edge, moved, edge, target);
+        break;
+    case TRANSITION_PUSH_LEFT:
+        shiftColumns(-moved);
+        // fall through
+    case TRANSITION_SLIDE_LEFT:
+        copyColumns(width - next, next, 0, target);
+        break;
+    case TRANSITION_PUSH_RIGHT:
+        shiftColumns(moved);
+        // fall through
+    case TRANSITION_SLIDE_RIGHT:
+        copyColumns(0, next, width - next, target);
+        break;
+    case TRANSITION_PUSH_UP:
+        copyRows(0, height - next, moved, display);
+        // fall through
+    case TRANSITION_SLIDE_UP:
+        copyRows(height - next, next, 0, target);
+        break;
+    case TRANSITION_PUSH_DOWN:
+        copyRows(next, height - next, edge, display);
+        // fall through
+    case TRANSITION_SLIDE_DOWN:
+        copyRows(0, next, height - next, target);
+        break;
+    }
+    edge = next;
+}
+
+//Copy count whole rows from row fromY on of a buffer to row y on of the display
+void DMDTransition::copyRows(int y, int count, int fromY, const byte *from)
+{
+    byte *display = dmd->getScreenRAM();
+    if (count > 0) dmd->markDirty(0, y, width - 1, y + count - 1);
+    if (fromY < y) {
+        // moving down within the display, copy bottom up so no row is overwritten before it is read
+        for (int k = count - 1; k >= 0; k--)
+            memcpy(display + dmd->rowOffset(y + k), from + dmd->rowOffset(fromY + k), rowBytes);
+    } else {
+        for (int k = 0; k < count; k++)
+            memcpy(display + dmd->rowOffset(y + k), from + dmd->rowOffset(fromY + k), rowBytes);
+    }
+}
+
+//Copy count columns from column fromX on of a buffer to column x on of the display, a byte at a time
+void DMDTransition::copyColumns(int x, int count, int fromX, const byte *from)
+{
+    if (count <= 0) return;
+    byte *display = dmd->getScreenRAM();
+    dmd->markDirty(x, 0, x + count - 1, height - 1);
+    for (int y = 0; y < height; y++) {
+        byte *row = display + dmd->rowOffset(y);
+        const byte *source = from + dmd->rowOffset(y);
+        int dx = x;
+        int sx = fromX;
+        int left = count;
+        while (left > 0) {
+            byte shift = dx & 0x07;
+            int n = 8 - shift;
+            if (n > left) n = left;
+            byte mask = (0xFF >> shift) & (byte)(0xFF << (8 - shift - n));
+            byte bits = DMDCanvas::readPixels(source, sx, rowBytes) >> shift;
+            row[dx >> 3] = (row[dx >> 3] & ~mask) | (bits & mask);
+            dx += n;
+            sx += n;
+            left -= n;
+        }
+    }
+}
+
+//Shift every row of the display amount pixels right, or left if amount is negative
+void DMDTransition::shiftColumns(int amount)
+{
+    if (amount == 0) return;
+    byte *display = dmd->getScreenRAM();
+    dmd->markDirty(0, 0, width - 1, height - 1);
+    for (int y = 0; y < height; y++) {
+        byte *row = display + dmd->rowOffset(y);
+        // each byte only reads bytes that have not been shifted yet
+        if (amount < 0) {
+            for (int i = 0; i < rowBytes; i++)
+                row[i] = DMDCanvas::readPixels(row, i * 8 - amount, rowBytes);
+        } else {
+            for (int i = rowBytes - 1; i >= 0; i--)
+                row[i] = DMDCanvas::readPixels(row, i * 8 - amount, rowBytes);
+        }
+    }
+}
+
+//Copy the next count pixels in the LFSR's order from the new screen to the display
+void DMDTransition::dissolve(unsigned long count)
+{
+    byte *display = dmd->getScreenRAM();
+    // pixels land all over the display
+    dmd->markDirty(0, 0, width - 1, height - 1);
+    while (count > 0) {
+        // states past the last pixel are skipped, at most half the sequence
+        do {
+            byte low = lfsr & 1;
+            lfsr >>= 1;
+            if (low) lfsr ^= taps;
+        } while (lfsr > pixels);
+        unsigned long pixel = lfsr - 1;
+        byte mask = 0x80 >> (pixel & 0x07);
+        DMDRamOffset b = pixel >> 3;
+        display[b] = (display[b] & ~mask) | (target[b] & mask);
+        count--;
+    }
+}
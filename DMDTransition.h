@@ -0,0 +1,109 @@
+/*--------------------------------------------------------------------------------------
+
+ DMDTransition.h - Screen transition effects for the Freetronics DMD library
+
+ Copyright (C) 2011 Marc Alexander (info <at> freetronics <dot> com)
+
+ A transition changes the display from what is on it now to a new screen drawn off-screen,
+ over a given number of steps, by wiping, sliding the new screen in over the old, pushing
+ the old screen out, or dissolving pixels in a pseudo-random order. Each step works a byte
+ at a time on whole rows or a fixed share of pixels, so its cost is bounded and the same
+ from one step to the next, and update() runs a step whenever one is due without blocking.
+
+   transition.beginFrame();              //drawing now goes to the new screen
+   dmd.drawString( ... );
+   transition.start( TRANSITION_PUSH_LEFT, 32 );
+   while (transition.update()) { ... }   //or call update() from the main loop
+
+ ---
+
+ This program is free software: you can redistribute it and/or modify it under the terms
+ of the version 3 GNU General Public License as published by the Free Software Foundation.
+
+ This program is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ See the GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License along with this program.
+ If not, see <http://www.gnu.org/licenses/>.
+
+--------------------------------------------------------------------------------------*/
+#ifndef DMD_TRANSITION_H_
+#define DMD_TRANSITION_H_
+
+#include "DMD.h"
+#include "DMDScheduler.h"
+
+//Transition effects, the direction is the way the edge between the screens moves
+#define TRANSITION_WIPE_LEFT      0
+#define TRANSITION_WIPE_RIGHT     1
+#define TRANSITION_WIPE_UP        2
+#define TRANSITION_WIPE_DOWN      3
+#define TRANSITION_SLIDE_LEFT     4
+#define TRANSITION_SLIDE_RIGHT    5
+#define TRANSITION_SLIDE_UP       6
+#define TRANSITION_SLIDE_DOWN     7
+#define TRANSITION_PUSH_LEFT      8
+#define TRANSITION_PUSH_RIGHT     9
+#define TRANSITION_PUSH_UP        10
+#define TRANSITION_PUSH_DOWN      11
+#define TRANSITION_DISSOLVE       12
+
+class DMDTransition : public DMDTask
+{
+  public:
+    //Instantiate a transition for the display, with its own off-screen buffer for the new screen
+    DMDTransition(DMD &dmd);
+
+    //Direct drawing to the new screen, cleared to start with
+    void beginFrame();
+
+    //Return drawing to the display and start changing to the new screen in steps steps
+    void start(byte effect, unsigned int steps);
+
+    //Run the next step once the interval has passed, call as often as possible from the main loop.
+    //Returns true while the transition is running
+    boolean update();
+
+    //Scheduler task, runs the next step if one is due
+    boolean runTask();
+
+    //Run the next step now
+    void step();
+
+    //Show the new screen at once and end the transition
+    void finish();
+
+    boolean isRunning();
+
+    //Milliseconds between steps of update()
+    void setInterval(unsigned int interval);
+
+  private:
+    void copyRows(int y, int count, int fromY, const byte* from);
+    void copyColumns(int x, int count, int fromX, const byte* from);
+    void shiftColumns(int amount);
+    void dissolve(unsigned long pixels);
+
+    DMD *dmd;
+    byte *target;
+    int width, height;
+    int rowBytes;
+
+    byte effect;
+    unsigned int steps;
+    unsigned int stepCount;
+    int edge;
+    boolean running;
+
+    //Dissolve pixel order, a maximal length LFSR over the pixels of DMD RAM. Up to 17 bits it covers
+    //the 255 panels a DMD can drive, wider displays need DMD_WIDE_ADDRESSING for up to 32 bits
+    unsigned long lfsr;
+    unsigned long taps;
+    unsigned long pixels;
+
+    unsigned int interval;
+    unsigned long lastStep;
+};
+
+#endif /* DMD_TRANSITION_H_ */
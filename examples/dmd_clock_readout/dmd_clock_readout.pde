@@ -41,12 +41,17 @@
 --------------------------------------------------------------------------------------*/
 #include <SPI.h>        //SPI.h must be included as DMD is written by SPI (the IDE complains otherwise)
 #include <DMD.h>        //
+#include <DMDClock.h>   //
 #include <TimerOne.h>   //
-#include "Arial_black_16.h"
+#include "Arial14.h"
 
 //Fire up the DMD library as dmd
 DMD dmd(1,1);
 
+//4 digit clock readout with the colon after the second digit, cells touching so 12:34 fits one panel.
+//The digits are rendered once here, each update only copies the cells that changed
+DMDClock dmdClock( dmd, 1, 1, Arial_14, 4, 2, 0 );
+
 /*--------------------------------------------------------------------------------------
   Interrupt handler for Timer1 (TimerOne) driven DMD refresh scanning, this gets
   called at the period set in Timer1.initialize();
@@ -58,19 +63,12 @@ void ScanDMD()
 
 /*--------------------------------------------------------------------------------------
   Show clock numerals on the screen from a 4 digit time value, and select whether the
-  flashing colon is on or off
+  flashing colon is on or off. Only the digits that changed and the colon are redrawn
 --------------------------------------------------------------------------------------*/
 void ShowClockNumbers( unsigned int uiTime, byte bColonOn )
 {
-   dmd.clearScreen(true);
-   dmd.drawChar(  1,  3,'0'+((uiTime%10000)/1000), GRAPHICS_NORMAL );   // thousands
-   dmd.drawChar(  8,  3, '0'+((uiTime%1000) /100),  GRAPHICS_NORMAL );   // hundreds
-   dmd.drawChar( 17,  3, '0'+((uiTime%100)  /10),   GRAPHICS_NORMAL );   // tens
-   dmd.drawChar( 25,  3, '0'+ (uiTime%10),          GRAPHICS_NORMAL );   // units
-   if( bColonOn )
-      dmd.drawChar( 15,  3, ':', GRAPHICS_OR     );   // clock colon overlay on
-   else
-      dmd.drawChar( 15,  3, ':', GRAPHICS_NOR    );   // clock colon overlay off
+   dmdClock.update( uiTime );
+   dmdClock.setColon( bColonOn );
 }
 
 /*--------------------------------------------------------------------------------------
@@ -86,7 +84,6 @@ void setup(void)
 
    //clear/init the DMD pixels held in RAM
    dmd.clearScreen( true );   //true is normal (all pixels off), false is negative (all pixels on)
-   dmd.selectFont(Arial_Black_16);
 
 }
 
@@ -96,26 +93,9 @@ void setup(void)
 --------------------------------------------------------------------------------------*/
 void loop(void)
 {
-   unsigned int ui;
-   
-   // 10 x 14 font clock, including demo of OR and NOR modes for pixels so that the flashing colon can be overlayed
-   ui = 1234;
-   ShowClockNumbers( ui, true );
-   delay( 1000 );
-   ShowClockNumbers( ui, false );
-   delay( 1000 );
-   ShowClockNumbers( ui, true );
-   delay( 1000 );
-   ShowClockNumbers( ui, false );
-   delay( 1000 );
-
-   ui = 2345;
-   ShowClockNumbers( ui, true );
-   delay( 1000 );
-   ShowClockNumbers( ui, false );
-   delay( 1000 );
-   ShowClockNumbers( ui, true );
-   delay( 1000 );
-   ShowClockNumbers( ui, false );
-   delay( 1000 );
+   unsigned long ulSeconds = millis() / 1000;
+
+   // minutes and seconds since reset, the colon flashes on for the first half of each second.
+   // Between changes this costs next to nothing, leaving the loop free for reading sensors
+   ShowClockNumbers( (ulSeconds / 60) % 60 * 100 + ulSeconds % 60, (millis() % 1000) < 500 );
 }
@@ -14,24 +14,21 @@ Latin-1 support.
 HOW TO ENTER Latin-1 CHARACTERS
 *******************************
 
-Unfortunately entering Latin-1 characters like Ã or è is not as simple as just
-typing them. Arduino Sketches are saved in Unicode UTF-8 format, but the DMD library
-does not understand Unicode (it's too complex.)
+Arduino Sketches are saved in Unicode UTF-8 format, and drawString and drawMarquee
+decode UTF-8, so characters like Ã or è can simply be typed into the string. Any
+character the selected font does not have is drawn as a '?'.
 
-To enter the characters as Latin-1, look at the codepage layout here and look for
-the hexadecimal digit that corresponds to the character you want.
+Strings written with Latin-1 escapes still work too. Look at the codepage layout
+here for the hexadecimal value of the character you want:
 https://en.wikipedia.org/wiki/ISO/IEC_8859-1#Codepage_layout
 
-For example, á (lowercase a, rising diacritical mark) has hex value 00E0 in Latin-1.
+For example, á (lowercase a, rising diacritical mark) has hex value 00E1 in Latin-1.
 To translate this into a constant string, replace the leading 00 with \x - so the
-string could be "The Portugese for rapid is r\xE0pido".
+string could be "The Portugese for rapid is r""\xE1""pido". Bytes that are not part
+of a valid UTF-8 sequence are drawn as Latin-1 characters.
 
-To be safe, the string may also need to be separated in its own quote marks - ie
-"The Portugese for rapid is r""\xE0""pido"
-
-When you compile the sketch, the compiler will join all these strings up into one
-long string - however without the quotes around the \x it may try to include additional
-characters as part of the hexadecimal sequence.
+The quote marks around the \x stop the compiler including the following characters
+as part of the hexadecimal sequence.
 
 /*--------------------------------------------------------------------------------------
   Includes
@@ -80,8 +77,7 @@ void loop(void)
 {
    dmd.clearScreen( true );
    dmd.selectFont(Arial_Black_16_ISO_8859_1);
-   // Français, Österreich, Magyarország
-   const char *MSG = "Fran""\xe7""ais, ""\xd6""sterreich, Magyarorsz""\xe1""g";
+   const char *MSG = "Français, Österreich, Magyarország";
    dmd.drawMarquee(MSG,strlen(MSG),(32*DISPLAYS_ACROSS)-1,0);
    long start=millis();
    long timer=start;
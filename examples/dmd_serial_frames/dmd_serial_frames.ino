@@ -0,0 +1,72 @@
+/*--------------------------------------------------------------------------------------
+
+ dmd_serial_frames.ino
+   Shows frames streamed from a PC over the serial port on the Freetronics DMD.
+
+ Copyright (C) 2011 Marc Alexander (info <at> freetronics <dot> com)
+
+ See http://www.freetronics.com/dmd for resources and a getting started guide.
+
+ Frames are decoded straight into the display RAM as they arrive, keyframes and
+ compressed deltas against the previous frame, so only changes use serial bandwidth.
+ On the PC, encode a sequence of PBM or PGM images with the script in the library's
+ extras folder and send it to the board, for example:
+
+   python extras/dmd_frames.py --panels 1x1 --fps 25 -o /dev/ttyACM0 frame*.pbm
+
+ This example code is in the public domain.
+ The DMD library is open source (GPL), for more see DMD.cpp and DMD.h
+
+--------------------------------------------------------------------------------------*/
+
+/*--------------------------------------------------------------------------------------
+  Includes
+--------------------------------------------------------------------------------------*/
+#include <SPI.h>        //SPI.h must be included as DMD is written by SPI (the IDE complains otherwise)
+#include <DMD.h>        //
+#include <DMDFrameDecoder.h>
+#include <TimerOne.h>   //
+
+//Fire up the DMD library as dmd
+#define DISPLAYS_ACROSS 1
+#define DISPLAYS_DOWN 1
+DMD dmd(DISPLAYS_ACROSS, DISPLAYS_DOWN);
+
+//Frames are decoded into the DMD's own RAM. A sketch using pages calls frames.setBuffer(dmd.getScreenRAM())
+//after dmd.setPages() and dmd.drawToPage(), as they move it
+DMDFrameDecoder frames(dmd.getScreenRAM(), dmd.getScreenRAMSize());
+
+/*--------------------------------------------------------------------------------------
+  Interrupt handler for Timer1 (TimerOne) driven DMD refresh scanning, this gets
+  called at the period set in Timer1.initialize();
+--------------------------------------------------------------------------------------*/
+void ScanDMD()
+{ 
+  dmd.scanDisplayBySPI();
+}
+
+/*--------------------------------------------------------------------------------------
+  setup
+  Called by the Arduino architecture before the main loop begins
+--------------------------------------------------------------------------------------*/
+void setup(void)
+{
+   Serial.begin( 115200 );
+
+   //initialize TimerOne's interrupt/CPU usage used to scan and refresh the display
+   Timer1.initialize( 5000 );           //period in microseconds to call ScanDMD. Anything longer than 5000 (5ms) and you can see flicker.
+   Timer1.attachInterrupt( ScanDMD );   //attach the Timer1 interrupt to ScanDMD which goes to dmd.scanDisplayBySPI()
+
+   //clear/init the DMD pixels held in RAM
+   dmd.clearScreen( true );   //true is normal (all pixels off), false is negative (all pixels on)
+}
+
+/*--------------------------------------------------------------------------------------
+  loop
+  Arduino architecture main loop
+--------------------------------------------------------------------------------------*/
+void loop(void)
+{
+   //decode whatever has arrived, the display updates as each run is written
+   frames.poll( Serial );
+}
@@ -0,0 +1,90 @@
+#!/usr/bin/env python3
+"""
+dmd_anim.py - Convert a sequence of images into a DMD flash animation header
+
+Copyright (C) 2011 Marc Alexander (info <at> freetronics <dot> com)
+
+Converts PBM/PGM images, one per frame, into a C header holding a PROGMEM
+animation for DMDAnimation. Frames are compressed with the same keyframe and
+delta coding as dmd_frames.py. A frame's duration can follow its file name:
+
+  dmd_anim.py --name boot --panels 1x1 --delay 80 f1.pbm f2.pbm f3.pbm:500 > boot_anim.h
+
+This program is free software: you can redistribute it and/or modify it under the terms
+of the version 3 GNU General Public License as published by the Free Software Foundation.
+"""
+import argparse
+import os
+import sys
+
+sys.path.insert(0, os.path.dirname(os.path.abspath(__file__)))
+import dmd_frames
+
+
+def build(frames, panels_wide, panels_high, threshold=128):
+    """frames is a list of (image path, duration ms), returns the animation bytes"""
+    size = panels_wide * panels_high * dmd_frames.PANEL_WIDTH * dmd_frames.PANEL_HEIGHT // 8
+    out = bytearray([len(frames) & 0xFF, len(frames) >> 8, size & 0xFF, size >> 8])
+    previous = None
+    for path, duration in frames:
+        rows = dmd_frames.read_image(path, threshold)[2]
+        ram = dmd_frames.to_ram(rows, panels_wide, panels_high)
+        out += bytes([duration & 0xFF, duration >> 8])
+        out += dmd_frames.encode_frame(ram, previous)
+        previous = ram
+    return bytes(out)
+
+
+def header(name, data, frames, panels):
+    guard = name.upper() + '_H'
+    lines = [
+        '/*',
+        ' * %s' % name,
+        ' *',
+        ' * DMD animation, %d frames for %s panels, %d bytes' % (frames, panels, len(data)),
+        ' * generated by dmd_anim.py, play with DMDAnimation',
+        ' */',
+        '',
+        '#include <inttypes.h>',
+        '#include <avr/pgmspace.h>',
+        '',
+        '#ifndef %s' % guard,
+        '#define %s' % guard,
+        '',
+        'const static uint8_t %s[] PROGMEM = {' % name,
+    ]
+    for i in range(0, len(data), 16):
+        lines.append('    ' + ' '.join('0x%02X,' % b for b in data[i:i + 16]))
+    lines += ['};', '', '#endif', '']
+    return '\n'.join(lines)
+
+
+def main():
+    parser = argparse.ArgumentParser(description='Convert PBM/PGM images into a DMD animation header')
+    parser.add_argument('images', nargs='+', help='images in frame order, optionally file:milliseconds')
+    parser.add_argument('--name', default='animation', help='C array name (default animation)')
+    parser.add_argument('--panels', default='1x1', help='panels across x down (default 1x1)')
+    parser.add_argument('--delay', type=int, default=100, help='default frame duration in milliseconds')
+    parser.add_argument('--threshold', type=int, default=128, help='PGM level (0-255) that lights a pixel')
+    parser.add_argument('-o', '--output', help='output header (default stdout)')
+    args = parser.parse_args()
+
+    frames = []
+    for image in args.images:
+        path, _, duration = image.rpartition(':')
+        if not path or not duration.isdigit():
+            path, duration = image, args.delay
+        frames.append((path, min(int(duration), 0xFFFF)))
+
+    panels_wide, panels_high = (int(v) for v in args.panels.lower().split('x'))
+    data = build(frames, panels_wide, panels_high, args.threshold)
+    text = header(args.name, data, len(frames), args.panels)
+    if args.output:
+        with open(args.output, 'w') as f:
+            f.write(text)
+    else:
+        sys.stdout.write(text)
+
+
+if __name__ == '__main__':
+    main()
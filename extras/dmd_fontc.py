@@ -0,0 +1,290 @@
+#!/usr/bin/env python3
+"""
+dmd_fontc.py - Compile fonts into the DMD row font format
+
+Copyright (C) 2011 Marc Alexander (info <at> freetronics <dot> com)
+
+Converts a FontCreator font header (such as the Arial14.h or SystemFont5x7.h bundled
+with the library) or a BDF font into a row font header. Row fonts store each glyph
+row by row in the framebuffer's own bit order with an offset index and optional per
+glyph run length coding, so the library draws them with byte blits instead of
+decoding FontCreator's column data a pixel at a time. Select the result with
+DMD::selectFont() like any other font; glyphs render pixel for pixel the same as
+the FontCreator original.
+
+  dmd_fontc.py Arial14.h > Arial14_rows.h
+  dmd_fontc.py --name Fixed6x13 --range 32-126,160-255 6x13.bdf > Fixed6x13.h
+
+BDF advance widths include the gap between characters, which drawString adds
+itself, so glyphs are one column narrower than their advance.
+
+This program is free software: you can redistribute it and/or modify it under the terms
+of the version 3 GNU General Public License as published by the Free Software Foundation.
+"""
+import argparse
+import os
+import re
+import sys
+
+ROW_MAGIC = (0xFF, 0xD5)
+GLYPH_RLE = 0x01
+
+
+class Glyph:
+    def __init__(self, code, width, pixels):
+        self.code = code        # code point
+        self.width = width      # pixels across
+        self.pixels = pixels    # rows of booleans, True = lit
+
+
+def glyph_rows(height):
+    """Rows drawChar renders for a FontCreator font, single byte fonts include the row beneath"""
+    return height + 1 if height < 8 else height
+
+
+def read_fontcreator(path):
+    """Parse a FontCreator header, returns (height, rows per glyph, glyphs)"""
+    with open(path) as f:
+        text = f.read()
+    text = re.sub(r'/\*.*?\*/', '', text, flags=re.S)
+    text = re.sub(r'//[^\n]*', '', text)
+    body = text[text.index('{', text.index('PROGMEM')) + 1:]
+    body = body[:body.index('}')]
+    data = [int(v, 0) for v in re.findall(r'0[xX][0-9a-fA-F]+|\d+', body)]
+
+    fixed = data[0] == 0 and data[1] == 0
+    height, first, count = data[3], data[4], data[5]
+    nbytes = (height + 7) // 8
+    rows = glyph_rows(height)
+    glyphs = []
+    index = count + 6
+    for c in range(count):
+        if fixed:
+            width = data[2]
+            start = c * nbytes * width + 6
+        else:
+            width = data[6 + c]
+            start = index
+            index += width * nbytes
+        pixels = [[False] * width for _ in range(rows)]
+        # same decode as DMD::drawChar, the last byte of tall fonts is aligned to the bottom row
+        for j in range(width):
+            for i in range(nbytes - 1, -1, -1):
+                value = data[start + j + i * width]
+                offset = height - 8 if (i == nbytes - 1 and nbytes > 1) else i * 8
+                for k in range(8):
+                    y = offset + k
+                    if i * 8 <= y <= height and y < rows:
+                        pixels[y][j] = bool(value & (1 << k))
+        glyphs.append(Glyph(first + c, width, pixels))
+    return height, rows, glyphs
+
+
+def read_bdf(path):
+    """Parse a BDF font, returns (height, rows per glyph, glyphs)"""
+    ascent = descent = None
+    bbox = None
+    glyphs = []
+    with open(path) as f:
+        lines = iter(f.read().splitlines())
+    for line in lines:
+        words = line.split()
+        if not words:
+            continue
+        if words[0] == 'FONTBOUNDINGBOX':
+            bbox = [int(v) for v in words[1:5]]
+        elif words[0] == 'FONT_ASCENT':
+            ascent = int(words[1])
+        elif words[0] == 'FONT_DESCENT':
+            descent = int(words[1])
+        elif words[0] == 'STARTCHAR':
+            code = -1
+            advance = 0
+            w = h = xo = yo = 0
+            bitmap = []
+            for line in lines:
+                words = line.split()
+                if not words:
+                    continue
+                if words[0] == 'ENCODING':
+                    code = int(words[1])
+                elif words[0] == 'DWIDTH':
+                    advance = int(words[1])
+                elif words[0] == 'BBX':
+                    w, h, xo, yo = (int(v) for v in words[1:5])
+                elif words[0] == 'BITMAP':
+                    for line in lines:
+                        if line.strip() == 'ENDCHAR':
+                            break
+                        bitmap.append(int(line.strip(), 16) if line.strip() else 0)
+                    break
+            if code >= 0:
+                glyphs.append((code, advance, w, h, xo, yo, bitmap))
+    if ascent is None:
+        ascent = bbox[1] + bbox[3]
+    if descent is None:
+        descent = -bbox[3]
+    height = ascent + descent
+
+    result = []
+    for code, advance, w, h, xo, yo, bitmap in glyphs:
+        width = max(advance - 1, xo + w, 0)
+        pixels = [[False] * width for _ in range(height)]
+        bits = ((w + 7) // 8) * 8
+        for by, value in enumerate(bitmap[:h]):
+            y = ascent - (yo + h) + by
+            if not 0 <= y < height:
+                continue
+            for bx in range(w):
+                x = xo + bx
+                if 0 <= x < width and value & (1 << (bits - 1 - bx)):
+                    pixels[y][x] = True
+        result.append(Glyph(code, width, pixels))
+    return height, height, result
+
+
+def rle(data):
+    """n < 0x80 is n+1 literal bytes, n >= 0x80 repeats the next byte n-0x80+2 times"""
+    out = bytearray()
+    literals = bytearray()
+
+    def flush():
+        while literals:
+            chunk = literals[:128]
+            out.append(len(chunk) - 1)
+            out.extend(chunk)
+            del literals[:128]
+
+    i = 0
+    while i < len(data):
+        run = 1
+        while i + run < len(data) and run < 129 and data[i + run] == data[i]:
+            run += 1
+        if run >= 2:
+            flush()
+            out += bytes([0x80 + run - 2, data[i]])
+            i += run
+        else:
+            literals.append(data[i])
+            i += 1
+    flush()
+    return bytes(out)
+
+
+def pack_rows(glyph):
+    """Glyph rows in framebuffer bit order, MSB is the leftmost pixel, one bit is lit"""
+    out = bytearray()
+    stride = (glyph.width + 7) // 8
+    for row in glyph.pixels:
+        packed = bytearray(stride)
+        for x, lit in enumerate(row):
+            if lit:
+                packed[x // 8] |= 0x80 >> (x & 7)
+        out += packed
+    return bytes(out)
+
+
+def compile_font(height, rows, glyphs, compress=True):
+    glyphs = sorted({g.code: g for g in glyphs if g.code <= 0xFFFF}.values(), key=lambda g: g.code)
+    if any(g.width > 255 for g in glyphs):
+        raise ValueError('glyphs wider than 255 pixels are not supported')
+
+    ranges = []
+    for n, g in enumerate(glyphs):
+        if ranges and ranges[-1][0] + ranges[-1][1] == g.code:
+            ranges[-1][1] += 1
+        else:
+            ranges.append([g.code, 1, n])
+    if len(ranges) > 255:
+        raise ValueError('too many code point ranges (%d), narrow the --range' % len(ranges))
+
+    records = []
+    for g in glyphs:
+        data = pack_rows(g)
+        flags = 0
+        if compress:
+            packed = rle(data)
+            if len(packed) < len(data):
+                data, flags = packed, GLYPH_RLE
+        records.append(bytes([g.width, flags]) + data)
+
+    widest = max([g.width for g in glyphs] or [0])
+    out = bytearray([ROW_MAGIC[0], ROW_MAGIC[1], widest, height, rows, len(ranges)])
+    for first, count, number in ranges:
+        out += bytes([first & 0xFF, first >> 8, count & 0xFF, count >> 8, number & 0xFF, number >> 8])
+    offset = len(out) + 2 * len(records)
+    for record in records:
+        if offset > 0xFFFF:
+            raise ValueError('compiled font is larger than 64K')
+        out += bytes([offset & 0xFF, offset >> 8])
+        offset += len(record)
+    for record in records:
+        out += record
+    return bytes(out), ranges
+
+
+def header(name, source, data, height, glyphs, ranges):
+    guard = name.upper() + '_H'
+    lines = [
+        '/*',
+        ' *',
+        ' * %s' % name,
+        ' *',
+        ' * DMD row font compiled by dmd_fontc.py from %s' % os.path.basename(source),
+        ' * Font size in bytes  : %d' % len(data),
+        ' * Font height         : %d' % height,
+        ' * Font used chars     : %d' % glyphs,
+        ' * Code point ranges   : %s' % ', '.join('%d-%d' % (f, f + c - 1) for f, c, _ in ranges),
+        ' */',
+        '',
+        '#include <inttypes.h>',
+        '#include <avr/pgmspace.h>',
+        '',
+        '#ifndef %s' % guard,
+        '#define %s' % guard,
+        '',
+        'const static uint8_t %s[] PROGMEM = {' % name,
+    ]
+    for i in range(0, len(data), 16):
+        lines.append('    ' + ' '.join('0x%02X,' % b for b in data[i:i + 16]))
+    lines += ['};', '', '#endif', '']
+    return '\n'.join(lines)
+
+
+def parse_ranges(text):
+    codes = set()
+    for part in text.split(','):
+        first, _, last = part.partition('-')
+        codes.update(range(int(first, 0), int(last or first, 0) + 1))
+    return codes
+
+
+def main():
+    parser = argparse.ArgumentParser(description='Compile a FontCreator header or BDF font into a DMD row font')
+    parser.add_argument('font', help='FontCreator .h or .bdf font')
+    parser.add_argument('--name', help='C array name (default from the file name)')
+    parser.add_argument('--range', help='code points to keep, for example 32-126,160-255')
+    parser.add_argument('--no-rle', action='store_true', help='store every glyph uncompressed')
+    parser.add_argument('-o', '--output', help='output header (default stdout)')
+    args = parser.parse_args()
+
+    if args.font.lower().endswith('.bdf'):
+        height, rows, glyphs = read_bdf(args.font)
+    else:
+        height, rows, glyphs = read_fontcreator(args.font)
+    if args.range:
+        keep = parse_ranges(args.range)
+        glyphs = [g for g in glyphs if g.code in keep]
+    name = args.name or re.sub(r'\W', '_', os.path.splitext(os.path.basename(args.font))[0]) + '_rows'
+
+    data, ranges = compile_font(height, rows, glyphs, not args.no_rle)
+    text = header(name, args.font, data, height, len(glyphs), ranges)
+    if args.output:
+        with open(args.output, 'w') as f:
+            f.write(text)
+    else:
+        sys.stdout.write(text)
+
+
+if __name__ == '__main__':
+    main()
@@ -0,0 +1,169 @@
+#!/usr/bin/env python3
+"""
+dmd_frames.py - Encode images into the DMD frame stream format
+
+Copyright (C) 2011 Marc Alexander (info <at> freetronics <dot> com)
+
+Converts PBM/PGM images (one per frame) into the compressed frame stream that
+DMDFrameDecoder reads, laid out in DMD RAM order for a given panel arrangement.
+The first frame is sent as a keyframe, later frames as XOR deltas against the
+previous one unless a keyframe is smaller (or forced with --key-every).
+
+  dmd_frames.py --panels 2x1 frame*.pbm > frames.bin
+  dmd_frames.py --panels 1x1 --fps 20 frame*.pgm > /dev/ttyACM0
+
+The stream can be written to a serial port, a file or a pipe, and the same bytes
+fed to DMDFrameDecoder on a PC to check what the board will show.
+
+This program is free software: you can redistribute it and/or modify it under the terms
+of the version 3 GNU General Public License as published by the Free Software Foundation.
+"""
+import argparse
+import sys
+import time
+
+PANEL_WIDTH = 32
+PANEL_HEIGHT = 16
+
+FRAME_MAGIC = 0xD3
+FRAME_KEY = ord('K')
+FRAME_DELTA = ord('D')
+
+
+def read_image(path, threshold=128):
+    """Read a PBM or PGM file, returns (width, height, rows of booleans, True = lit)"""
+    with open(path, 'rb') as f:
+        data = f.read()
+    fields = []
+    pos = 0
+    needed = 3 if data[:2] in (b'P1', b'P4') else 4
+    while len(fields) < needed:
+        while data[pos:pos + 1].isspace():
+            pos += 1
+        if data[pos:pos + 1] == b'#':
+            while data[pos:pos + 1] not in (b'\n', b''):
+                pos += 1
+            continue
+        start = pos
+        while pos < len(data) and not data[pos:pos + 1].isspace():
+            pos += 1
+        fields.append(data[start:pos])
+    magic = fields[0]
+    width, height = int(fields[1]), int(fields[2])
+    maxval = int(fields[3]) if needed == 4 else 1
+    if magic in (b'P4', b'P5'):
+        pos += 1    # single whitespace before the raster
+        raster = data[pos:]
+    elif magic == b'P1':
+        # plain PBM digits need no whitespace between them
+        raster = [int(v) for v in data[pos:].decode('ascii') if v in '01']
+    else:
+        raster = [int(v) for v in data[pos:].split()]
+
+    rows = []
+    if magic == b'P1':
+        for y in range(height):
+            rows.append([raster[y * width + x] == 1 for x in range(width)])
+    elif magic == b'P4':
+        stride = (width + 7) // 8
+        for y in range(height):
+            rows.append([bool(raster[y * stride + x // 8] & (0x80 >> (x & 7))) for x in range(width)])
+    elif magic in (b'P2', b'P5'):
+        step = 2 if maxval > 255 else 1
+        level = threshold * maxval // 255
+        for y in range(height):
+            row = []
+            for x in range(width):
+                i = (y * width + x) * step
+                v = raster[i] if magic == b'P2' else int.from_bytes(raster[i:i + step], 'big')
+                row.append(v >= level)
+            rows.append(row)
+    else:
+        raise ValueError('%s: not a PBM or PGM image' % path)
+    return width, height, rows
+
+
+def to_ram(rows, panels_wide, panels_high):
+    """Lay out an image in DMD RAM order, pixels outside the image are off"""
+    total = panels_wide * panels_high
+    ram = bytearray([0xFF]) * (total * PANEL_WIDTH * PANEL_HEIGHT // 8)
+    for y, row in enumerate(rows[:panels_high * PANEL_HEIGHT]):
+        for x, lit in enumerate(row[:panels_wide * PANEL_WIDTH]):
+            if lit:
+                panel = x // PANEL_WIDTH + panels_wide * (y // PANEL_HEIGHT)
+                bx = x % PANEL_WIDTH + panel * PANEL_WIDTH
+                ram[bx // 8 + (y % PANEL_HEIGHT) * total * PANEL_WIDTH // 8] &= ~(0x80 >> (bx & 7)) & 0xFF
+    return bytes(ram)
+
+
+def rle(data):
+    """Run length encode: n < 0x80 is n+1 literals, n >= 0x80 repeats the next byte n-0x80+2 times"""
+    out = bytearray()
+    literals = bytearray()
+
+    def flush():
+        while literals:
+            chunk = literals[:128]
+            out.append(len(chunk) - 1)
+            out.extend(chunk)
+            del literals[:128]
+
+    i = 0
+    while i < len(data):
+        run = 1
+        while i + run < len(data) and run < 129 and data[i + run] == data[i]:
+            run += 1
+        if run >= 2:
+            flush()
+            out.append(0x80 + run - 2)
+            out.append(data[i])
+            i += run
+        else:
+            literals.append(data[i])
+            i += 1
+    flush()
+    return bytes(out)
+
+
+def encode_frame(ram, previous=None):
+    """Encode one frame, as a delta against previous when that is smaller"""
+    if len(ram) > 0xFFFF:
+        raise ValueError('frames carry a 16 bit length, %d bytes of DMD RAM is too many' % len(ram))
+    header = bytes([FRAME_MAGIC, 0, len(ram) & 0xFF, len(ram) >> 8])
+    best = bytes([FRAME_MAGIC, FRAME_KEY]) + header[2:] + rle(ram)
+    if previous is not None:
+        delta = rle(bytes(a ^ b for a, b in zip(ram, previous)))
+        if len(delta) + 4 < len(best):
+            best = bytes([FRAME_MAGIC, FRAME_DELTA]) + header[2:] + delta
+    return best
+
+
+def main():
+    parser = argparse.ArgumentParser(description='Encode PBM/PGM images into a DMD frame stream')
+    parser.add_argument('images', nargs='+', help='PBM or PGM images, one per frame')
+    parser.add_argument('--panels', default='1x1', help='panels across x down (default 1x1)')
+    parser.add_argument('--threshold', type=int, default=128, help='PGM level (0-255) that lights a pixel')
+    parser.add_argument('--key-every', type=int, default=0, help='force a keyframe every N frames')
+    parser.add_argument('--fps', type=float, default=0, help='pace the output, for writing to a serial port')
+    parser.add_argument('-o', '--output', help='output file or serial device (default stdout)')
+    args = parser.parse_args()
+
+    panels_wide, panels_high = (int(v) for v in args.panels.lower().split('x'))
+    out = open(args.output, 'wb') if args.output else sys.stdout.buffer
+    previous = None
+    for n, path in enumerate(args.images):
+        width, height, rows = read_image(path, args.threshold)
+        ram = to_ram(rows, panels_wide, panels_high)
+        if args.key_every and n % args.key_every == 0:
+            previous = None
+        out.write(encode_frame(ram, previous))
+        out.flush()
+        previous = ram
+        if args.fps:
+            time.sleep(1.0 / args.fps)
+    if args.output:
+        out.close()
+
+
+if __name__ == '__main__':
+    main()
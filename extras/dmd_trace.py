@@ -0,0 +1,106 @@
+#!/usr/bin/env python3
+"""
+dmd_trace.py - Summarise trace dumps from a DMD library built with DMD_TRACE
+
+Copyright (C) 2011 Marc Alexander (info <at> freetronics <dot> com)
+
+Reads the output of DMDTrace::dump() captured from the serial port, any other
+text around the dumps is ignored, and prints the calls, total and self time of
+each traced function. Self time leaves out the time spent in traced calls made
+from inside, including scans interrupting it. With --timeline every call is
+listed in the order it started, indented by how deeply it was nested.
+
+  dmd_trace.py capture.txt
+  dmd_trace.py --timeline --once /dev/ttyACM0
+
+Calls whose start was overwritten in the ring buffer, or still running when the
+dump was taken, are left out.
+
+This program is free software: you can redistribute it and/or modify it under the terms
+of the version 3 GNU General Public License as published by the Free Software Foundation.
+"""
+import argparse
+import sys
+
+WRAP = 1 << 32    # micros() wraps around after about 71 minutes
+
+
+def read_events(lines, once=False):
+    """Yield the (time, starting, name) events of each dump, and None at the end of each"""
+    inside = False
+    for line in lines:
+        line = line.strip()
+        if line.startswith('DMD trace end'):
+            if inside:
+                yield None
+            inside = False
+            if once:
+                return
+        elif line.startswith('DMD trace'):
+            inside = True
+        elif inside:
+            fields = line.split(None, 2)
+            if len(fields) == 3 and fields[0].isdigit() and fields[1] in '<>':
+                yield int(fields[0]), fields[1] == '>', fields[2]
+
+
+def analyse(events):
+    """Match starts with ends, returns per-name [calls, total, self] and the (start, depth, name, time)
+    of each call in the order they started"""
+    totals = {}
+    calls = []
+    stack = []    # [name, start time, time in nested calls, order started]
+    started = 0
+    for event in events:
+        if event is None:
+            stack = []    # dumps empty the buffer, so nothing is matched across them
+            continue
+        time, starting, name = event
+        if starting:
+            stack.append([name, time, 0, started])
+            started += 1
+            continue
+        names = [entry[0] for entry in stack]
+        if name not in names:
+            continue    # its start was lost
+        while stack[-1][0] != name:
+            stack.pop()    # calls whose end was lost
+        entry = stack.pop()
+        duration = (time - entry[1]) % WRAP
+        row = totals.setdefault(name, [0, 0, 0])
+        row[2] += duration - entry[2]
+        # a call nested in another of the same name is already in the outer call's total
+        if all(outer[0] != name for outer in stack):
+            row[0] += 1
+            row[1] += duration
+        if stack:
+            stack[-1][2] += duration
+        calls.append((entry[3], entry[1], len(stack), name, duration))
+    return totals, [call[1:] for call in sorted(calls)]
+
+
+def main():
+    parser = argparse.ArgumentParser(description='Summarise DMD trace dumps')
+    parser.add_argument('capture', nargs='?', default='-', help='captured serial output (default stdin)')
+    parser.add_argument('--timeline', action='store_true', help='list every call as well')
+    parser.add_argument('--once', action='store_true', help='stop after the first dump, for reading a serial port')
+    args = parser.parse_args()
+
+    source = sys.stdin if args.capture == '-' else open(args.capture, errors='replace')
+    totals, calls = analyse(read_events(source, args.once))
+    if not calls:
+        sys.exit('no complete calls found')
+
+    if args.timeline:
+        origin = calls[0][0]
+        for start, depth, name, duration in calls:
+            print('%10d  %s%-*s %8d us' % ((start - origin) % WRAP, '  ' * depth, max(0, 24 - 2 * depth), name, duration))
+        print()
+
+    print('%-24s %8s %12s %12s %10s' % ('function', 'calls', 'total us', 'self us', 'mean us'))
+    for name, (count, total, own) in sorted(totals.items(), key=lambda item: -item[1][2]):
+        print('%-24s %8d %12d %12d %10.1f' % (name, count, total, own, total / count if count else 0))
+
+
+if __name__ == '__main__':
+    main()